@@ -0,0 +1,386 @@
+#include "cangateway.h"
+#include "canmanager.h"
+
+#include <cstddef>
+#include <cstring>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/un.h>
+#include <linux/can.h>
+#include <errno.h>
+#include <QStringList>
+#include <QDebug>
+
+// cannelloni data packet: version, op_code, seq_no, count (big endian)
+static const uint8_t kCannelloniVersion = 2;
+static const uint8_t kCannelloniOpData = 0;
+static const int kHeaderSize = 5;
+// can_id (4, big endian) + len (1) + up to 8 data bytes
+static const int kMaxFrameSize = 4 + 1 + 8;
+static const int kMinFrameSize = 4 + 1;
+static const uint8_t kCanFdFlag = 0x80;
+
+double CanGateway::Stats::fillRatio() const
+{
+    if (datagramsOut == 0) return 0.0;
+    return double(framesToNet) / (double(datagramsOut) * CanGateway::framesPerDatagram());
+}
+
+double CanGateway::Stats::avgLatencyUs() const
+{
+    if (framesToNet == 0) return 0.0;
+    return double(latencySumUs) / double(framesToNet);
+}
+
+int CanGateway::framesPerDatagram()
+{
+    return (kMaxDatagram - kHeaderSize) / kMaxFrameSize;
+}
+
+CanGateway::CanGateway(CanManager *can, QObject *parent)
+    : QObject(parent), m_can(can)
+{
+    std::memset(&m_peer, 0, sizeof(m_peer));
+    std::memset(m_txLen, 0, sizeof(m_txLen));
+    std::memset(m_txFrames, 0, sizeof(m_txFrames));
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_flushTimer, &QTimer::timeout, this, &CanGateway::flush);
+    connect(m_can, &CanManager::canFrameReceived, this, &CanGateway::onFrameReceived);
+    m_clock.start();
+}
+
+CanGateway::~CanGateway()
+{
+    stop();
+}
+
+bool CanGateway::start(const QString &endpoint, int flushTimeoutMs)
+{
+    stop();
+    m_flushTimeoutMs = qMax(0, flushTimeoutMs);
+    if (!openEndpoint(endpoint)) return false;
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &CanGateway::onSocketReadable);
+    return true;
+}
+
+void CanGateway::stop()
+{
+    if (m_fd >= 0) flush();
+    m_flushTimer.stop();
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = nullptr;
+    }
+    if (m_fd >= 0) {
+        struct sockaddr_un local;
+        socklen_t localLen = sizeof(local);
+        bool isUnix = getsockname(m_fd, (struct sockaddr *)&local, &localLen) == 0
+                && local.sun_family == AF_UNIX && local.sun_path[0] != '\0';
+        ::close(m_fd);
+        m_fd = -1;
+        if (isUnix) ::unlink(local.sun_path);
+    }
+    m_txCount = 0;
+    m_txLen[0] = 0;
+    m_txFrames[0] = 0;
+    m_pendingFrames = 0;
+    m_pendingSumNs = 0;
+}
+
+bool CanGateway::isRunning() const { return m_fd >= 0; }
+
+bool CanGateway::openEndpoint(const QString &endpoint)
+{
+    std::memset(&m_peer, 0, sizeof(m_peer));
+    QStringList parts = endpoint.trimmed().split(':');
+    QString kind = parts.value(0).toLower();
+
+    if (kind == "udp" && (parts.size() == 4 || parts.size() == 5)) {
+        // optional bind address in front; default to loopback only
+        QString bindAddr = parts.size() == 5 ? parts.takeAt(1) : QString("127.0.0.1");
+        struct in_addr bindIp;
+        if (inet_pton(AF_INET, bindAddr.toLatin1().constData(), &bindIp) != 1) {
+            emit gatewayError(QString("invalid bind address in %1").arg(endpoint));
+            return false;
+        }
+        bool ok = false;
+        int localPort = parts[1].toInt(&ok);
+        if (!ok || localPort < 0 || localPort > 65535) {
+            emit gatewayError(QString("invalid local port in %1").arg(endpoint));
+            return false;
+        }
+
+        struct addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        struct addrinfo *res = nullptr;
+        int rc = getaddrinfo(parts[2].toLocal8Bit().constData(),
+                             parts[3].toLocal8Bit().constData(), &hints, &res);
+        if (rc != 0 || !res) {
+            emit gatewayError(QString("cannot resolve %1: %2").arg(parts[2], gai_strerror(rc)));
+            return false;
+        }
+        std::memcpy(&m_peer, res->ai_addr, res->ai_addrlen);
+        m_peerLen = res->ai_addrlen;
+        freeaddrinfo(res);
+
+        m_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        if (m_fd < 0) {
+            emit gatewayError(QString("socket() failed: %1").arg(strerror(errno)));
+            return false;
+        }
+        struct sockaddr_in local;
+        std::memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr = bindIp;
+        local.sin_port = htons(static_cast<uint16_t>(localPort));
+        if (bind(m_fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+            emit gatewayError(QString("bind udp:%1:%2 failed: %3").arg(bindAddr).arg(localPort).arg(strerror(errno)));
+            ::close(m_fd); m_fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    if (kind == "unix" && parts.size() == 3) {
+        QByteArray localPath = parts[1].toLocal8Bit();
+        QByteArray peerPath = parts[2].toLocal8Bit();
+        struct sockaddr_un local;
+        struct sockaddr_un *peer = reinterpret_cast<struct sockaddr_un *>(&m_peer);
+        if (localPath.isEmpty() || peerPath.isEmpty()
+                || localPath.size() >= (int)sizeof(local.sun_path)
+                || peerPath.size() >= (int)sizeof(peer->sun_path)) {
+            emit gatewayError(QString("invalid unix socket path in %1").arg(endpoint));
+            return false;
+        }
+        peer->sun_family = AF_UNIX;
+        std::strncpy(peer->sun_path, peerPath.constData(), sizeof(peer->sun_path) - 1);
+        m_peerLen = sizeof(struct sockaddr_un);
+
+        m_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        if (m_fd < 0) {
+            emit gatewayError(QString("socket() failed: %1").arg(strerror(errno)));
+            return false;
+        }
+        std::memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        std::strncpy(local.sun_path, localPath.constData(), sizeof(local.sun_path) - 1);
+        ::unlink(local.sun_path);   // stale socket from a previous run
+        if (bind(m_fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+            emit gatewayError(QString("bind %1 failed: %2").arg(parts[1], strerror(errno)));
+            ::close(m_fd); m_fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    emit gatewayError(QString("unsupported gateway endpoint: %1").arg(endpoint));
+    return false;
+}
+
+// ------------------------- CAN -> net -------------------------
+
+void CanGateway::onFrameReceived(const struct can_frame &frame)
+{
+    if (m_fd < 0) return;
+
+    if (m_txLen[m_txCount] + kMaxFrameSize > kMaxDatagram) {
+        sealDatagram();
+        if (m_txCount == kMaxBatch) flush();
+    }
+
+    uint8_t *buf = m_txBuf[m_txCount];
+    int &len = m_txLen[m_txCount];
+    if (len == 0) len = kHeaderSize;
+
+    // can_id goes out as received: EFF/RTR flags tell the peer what to rebuild
+    uint32_t wireId = htonl(frame.can_id);
+    int dlc = qMin<int>(frame.can_dlc, 8);
+    int dataLen = (frame.can_id & CAN_RTR_FLAG) ? 0 : dlc;
+    std::memcpy(buf + len, &wireId, 4);
+    buf[len + 4] = static_cast<uint8_t>(dlc);
+    if (dataLen > 0) std::memcpy(buf + len + 5, frame.data, dataLen);
+    len += kMinFrameSize + dataLen;
+    m_txFrames[m_txCount]++;
+
+    qint64 now = m_clock.nsecsElapsed();
+    if (m_pendingFrames == 0) m_pendingOldestNs = now;
+    m_pendingFrames++;
+    m_pendingSumNs += now;
+
+    // a zero timeout fires once control returns to the event loop, i.e.
+    // after CanManager has emitted the rest of its recvmmsg batch
+    if (!m_flushTimer.isActive()) m_flushTimer.start(m_flushTimeoutMs);
+}
+
+void CanGateway::sealDatagram()
+{
+    if (m_txCount >= kMaxBatch || m_txLen[m_txCount] == 0) return;
+    uint8_t *buf = m_txBuf[m_txCount];
+    uint16_t count = htons(static_cast<uint16_t>(m_txFrames[m_txCount]));
+    buf[0] = kCannelloniVersion;
+    buf[1] = kCannelloniOpData;
+    buf[2] = m_seq++;
+    std::memcpy(buf + 3, &count, 2);
+    m_txCount++;
+    if (m_txCount < kMaxBatch) {
+        m_txLen[m_txCount] = 0;
+        m_txFrames[m_txCount] = 0;
+    }
+}
+
+void CanGateway::flush()
+{
+    m_flushTimer.stop();
+    sealDatagram();
+    if (m_txCount == 0 || m_fd < 0) return;
+
+    struct mmsghdr msgs[kMaxBatch];
+    struct iovec iov[kMaxBatch];
+    std::memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < m_txCount; ++i) {
+        iov[i].iov_base = m_txBuf[i];
+        iov[i].iov_len = m_txLen[i];
+        msgs[i].msg_hdr.msg_name = &m_peer;
+        msgs[i].msg_hdr.msg_namelen = m_peerLen;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int sent = 0;
+    while (sent < m_txCount) {
+        int n = sendmmsg(m_fd, msgs + sent, m_txCount - sent, 0);
+        if (n <= 0) {
+            // peer not listening (ECONNREFUSED / ENOENT) or queue full: drop the rest
+            m_stats.sendErrors += m_txCount - sent;
+            break;
+        }
+        for (int i = sent; i < sent + n; ++i) m_stats.framesToNet += m_txFrames[i];
+        sent += n;
+    }
+    m_stats.datagramsOut += sent;
+
+    qint64 now = m_clock.nsecsElapsed();
+    if (m_pendingFrames > 0) {
+        m_stats.latencySumUs += quint64((m_pendingFrames * now - m_pendingSumNs) / 1000);
+        m_stats.latencyMaxUs = qMax(m_stats.latencyMaxUs, quint64((now - m_pendingOldestNs) / 1000));
+    }
+
+    m_txCount = 0;
+    m_txLen[0] = 0;
+    m_txFrames[0] = 0;
+    m_pendingFrames = 0;
+    m_pendingSumNs = 0;
+}
+
+// ------------------------- net -> CAN -------------------------
+
+void CanGateway::onSocketReadable()
+{
+    struct mmsghdr msgs[kMaxBatch];
+    struct iovec iov[kMaxBatch];
+    std::memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < kMaxBatch; ++i) {
+        iov[i].iov_base = m_rxBuf[i];
+        iov[i].iov_len = kMaxRxDatagram;
+        msgs[i].msg_hdr.msg_name = &m_rxFrom[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(m_rxFrom[i]);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int n = recvmmsg(m_fd, msgs, kMaxBatch, MSG_DONTWAIT, nullptr);
+    if (n <= 0) return;
+    for (int i = 0; i < n; ++i) {
+        // whatever we decode is written to the bus; only the peer may do that
+        if (!isPeer(m_rxFrom[i], msgs[i].msg_hdr.msg_namelen)) {
+            m_stats.foreignDatagrams++;
+            continue;
+        }
+        m_stats.datagramsIn++;
+        // a cut-off datagram would only decode up to some frame in the middle
+        if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            m_stats.truncatedDatagrams++;
+            continue;
+        }
+        decodeDatagram(m_rxBuf[i], msgs[i].msg_len);
+    }
+}
+
+bool CanGateway::isPeer(const struct sockaddr_storage &from, socklen_t len) const
+{
+    if (len < sizeof(sa_family_t) || from.ss_family != m_peer.ss_family) return false;
+    if (from.ss_family == AF_INET) {
+        const struct sockaddr_in *a = reinterpret_cast<const struct sockaddr_in *>(&from);
+        const struct sockaddr_in *b = reinterpret_cast<const struct sockaddr_in *>(&m_peer);
+        return len >= sizeof(*a) && a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+    }
+    if (from.ss_family == AF_UNIX) {
+        const struct sockaddr_un *a = reinterpret_cast<const struct sockaddr_un *>(&from);
+        const struct sockaddr_un *b = reinterpret_cast<const struct sockaddr_un *>(&m_peer);
+        size_t off = offsetof(struct sockaddr_un, sun_path);
+        if (len <= off) return false;   // an unbound sender has no path
+        size_t n = strnlen(a->sun_path, qMin(size_t(len) - off, sizeof(a->sun_path)));
+        return n > 0 && n == strnlen(b->sun_path, sizeof(b->sun_path))
+                && std::memcmp(a->sun_path, b->sun_path, n) == 0;
+    }
+    return false;
+}
+
+void CanGateway::decodeDatagram(const uint8_t *buf, int len)
+{
+    if (len < kHeaderSize || buf[0] != kCannelloniVersion || buf[1] != kCannelloniOpData) {
+        m_stats.decodeErrors++;
+        return;
+    }
+    uint16_t count;
+    std::memcpy(&count, buf + 3, 2);
+    count = ntohs(count);
+
+    // written to the bus in chunks; a full-size datagram holds thousands of frames
+    enum { kChunk = 128 };
+    struct can_frame frames[kChunk];
+    int nframes = 0;
+    int pos = kHeaderSize;
+    for (int i = 0; i < count; ++i) {
+        if (pos + kMinFrameSize > len) { m_stats.decodeErrors++; break; }
+        uint32_t wireId;
+        std::memcpy(&wireId, buf + pos, 4);
+        uint8_t flen = buf[pos + 4];
+        pos += kMinFrameSize;
+        if (flen & kCanFdFlag) {
+            // CAN FD frame: skip the flags byte and payload, we only bridge classic CAN
+            flen &= ~kCanFdFlag;
+            pos += 1 + flen;
+            m_stats.decodeErrors++;
+            continue;
+        }
+        // a classic frame longer than 8 bytes leaves no way to find the next one
+        if (flen > 8) { m_stats.decodeErrors++; break; }
+        uint32_t canId = ntohl(wireId) & ~CAN_ERR_FLAG;
+        int dataLen = (canId & CAN_RTR_FLAG) ? 0 : flen;
+        if (pos + dataLen > len) { m_stats.decodeErrors++; break; }
+
+        struct can_frame &f = frames[nframes++];
+        std::memset(&f, 0, sizeof(f));
+        f.can_id = canId;
+        f.can_dlc = flen;
+        if (dataLen > 0) std::memcpy(f.data, buf + pos, dataLen);
+        pos += dataLen;
+
+        if (nframes == kChunk) {
+            m_stats.framesFromNet += m_can->sendFrames(frames, nframes);
+            nframes = 0;
+        }
+    }
+
+    if (nframes > 0) m_stats.framesFromNet += m_can->sendFrames(frames, nframes);
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <QObject>
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QSocketNotifier>
+#include <QString>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/can.h>
+
+class CanManager;
+
+// Bridges a CanManager to a local datagram endpoint using the cannelloni
+// wire format (v2, classic CAN frames). CAN->net frames are packed into
+// datagrams which are flushed when full or after the flush timeout; both
+// directions move data with recvmmsg/sendmmsg.
+//
+// Endpoint syntax:
+//   udp:[<bindaddr>:]<localport>:<remotehost>:<remoteport>
+//   unix:<localpath>:<remotepath>
+// Frames from the network go straight onto the bus, so the UDP socket binds
+// to 127.0.0.1 unless a bind address is given, and datagrams from anyone
+// but the configured remote are dropped.
+class CanGateway : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats {
+        quint64 framesToNet = 0;
+        quint64 framesFromNet = 0;
+        quint64 datagramsOut = 0;
+        quint64 datagramsIn = 0;
+        quint64 decodeErrors = 0;
+        quint64 truncatedDatagrams = 0;   // larger than the RX buffer, dropped
+        quint64 foreignDatagrams = 0;     // not from the configured peer, dropped
+        quint64 sendErrors = 0;
+        quint64 latencySumUs = 0;   // sum over frames of enqueue->send delay
+        quint64 latencyMaxUs = 0;
+
+        // average frames per datagram relative to what fits in one
+        double fillRatio() const;
+        double avgLatencyUs() const;
+    };
+
+    explicit CanGateway(CanManager *can, QObject *parent = nullptr);
+    ~CanGateway();
+
+    // flushTimeoutMs == 0 flushes once the current CAN RX batch is drained
+    bool start(const QString &endpoint, int flushTimeoutMs);
+    void stop();
+    bool isRunning() const;
+
+    Stats stats() const { return m_stats; }
+    void resetStats() { m_stats = Stats(); }
+
+    static int framesPerDatagram();
+
+signals:
+    void gatewayError(const QString &msg);
+
+private slots:
+    void onFrameReceived(const struct can_frame &frame);
+    void onSocketReadable();
+    void flush();
+
+private:
+    // kMaxDatagram limits what we pack; peers (cannelloni: 1472 bytes) may
+    // send more, so incoming datagrams get room for the largest UDP payload
+    enum { kMaxDatagram = 1200, kMaxRxDatagram = 65535, kMaxBatch = 16 };
+
+    bool openEndpoint(const QString &endpoint);
+    void sealDatagram();
+    void decodeDatagram(const uint8_t *buf, int len);
+    bool isPeer(const struct sockaddr_storage &from, socklen_t len) const;
+
+    CanManager *m_can = nullptr;
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QTimer m_flushTimer;
+    int m_flushTimeoutMs = 0;
+
+    struct sockaddr_storage m_peer;
+    socklen_t m_peerLen = 0;
+
+    // outgoing: kMaxBatch datagram buffers; m_txCount sealed + one being filled
+    uint8_t m_txBuf[kMaxBatch][kMaxDatagram];
+    int m_txLen[kMaxBatch];
+    int m_txFrames[kMaxBatch];
+    int m_txCount = 0;
+    uint8_t m_seq = 0;
+
+    // enqueue timestamps of pending frames, for added-latency accounting
+    QElapsedTimer m_clock;
+    qint64 m_pendingFrames = 0;
+    qint64 m_pendingSumNs = 0;
+    qint64 m_pendingOldestNs = 0;
+
+    // incoming
+    uint8_t m_rxBuf[kMaxBatch][kMaxRxDatagram];
+    struct sockaddr_storage m_rxFrom[kMaxBatch];
+
+    Stats m_stats;
+};
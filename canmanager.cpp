@@ -6,12 +6,176 @@
 #include <net/if.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include <linux/can/error.h>
 #include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include <QDebug>
+#include <QFile>
+#include <QMetaMethod>
+#include <QThread>
+
+// frames drained per readable notification (recvmmsg) / written per sendmmsg
+static const int kCanBatch = 32;
+
+static qint64 clockNs(clockid_t clk)
+{
+    struct timespec ts;
+    clock_gettime(clk, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static inline void cpuRelax()
+{
+#if defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#elif defined(__x86_64__) || defined(__i386__)
+    asm volatile("pause" ::: "memory");
+#endif
+}
+
+// ------------------------- latency histogram -------------------------
+
+void RxLatencyHistogram::reset()
+{
+    for (int i = 0; i < kBuckets; ++i) buckets[i].store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    maxNs.store(0, std::memory_order_relaxed);
+}
+
+void RxLatencyHistogram::record(qint64 ns)
+{
+    if (ns < 0) ns = 0;
+    // bucket 0: < 1 us, bucket b: [2^(b-1), 2^b) us
+    quint64 us = quint64(ns) / 1000;
+    int b = 0;
+    while (us && b < kBuckets - 1) { us >>= 1; ++b; }
+    buckets[b].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    quint64 m = maxNs.load(std::memory_order_relaxed);
+    while (quint64(ns) > m && !maxNs.compare_exchange_weak(m, quint64(ns), std::memory_order_relaxed)) {}
+}
+
+quint64 RxLatencyHistogram::percentileUs(double p) const
+{
+    quint64 total = count.load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+    quint64 target = quint64(p * double(total) + 0.5);
+    if (target == 0) target = 1;
+    quint64 cum = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+        cum += buckets[b].load(std::memory_order_relaxed);
+        if (cum >= target) return quint64(1) << b;
+    }
+    return quint64(1) << (kBuckets - 1);
+}
+
+QString RxLatencyHistogram::report(const QString &name) const
+{
+    quint64 n = count.load(std::memory_order_relaxed);
+    if (n == 0) return QString("%1 -").arg(name);
+    return QString("%1 n=%2 p50<=%3 p99<=%4 max=%5 us").arg(name).arg(n)
+            .arg(percentileUs(0.50)).arg(percentileUs(0.99))
+            .arg(maxNs.load(std::memory_order_relaxed) / 1000);
+}
+
+// ------------------------- raw socket RX -------------------------
+
+void CanRxStats::reset()
+{
+    frames.store(0, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+    ctrlRxOverflow.store(0, std::memory_order_relaxed);
+    ctrlTxOverflow.store(0, std::memory_order_relaxed);
+    errorPassive.store(0, std::memory_order_relaxed);
+    busOff.store(0, std::memory_order_relaxed);
+    lastOvfl = 0;
+}
+
+CanRxCounters CanRxStats::snapshot() const
+{
+    CanRxCounters c;
+    c.frames = frames.load(std::memory_order_relaxed);
+    c.dropped = dropped.load(std::memory_order_relaxed);
+    c.ctrlRxOverflow = ctrlRxOverflow.load(std::memory_order_relaxed);
+    c.ctrlTxOverflow = ctrlTxOverflow.load(std::memory_order_relaxed);
+    c.errorPassive = errorPassive.load(std::memory_order_relaxed);
+    c.busOff = busOff.load(std::memory_order_relaxed);
+    return c;
+}
+
+int CanRxBatch::read(int fd, CanRxStats *stats, int maxFrames)
+{
+    int max = qBound(1, maxFrames, int(kMaxFrames));
+    struct mmsghdr msgs[kMaxFrames];
+    struct iovec iov[kMaxFrames];
+    char ctrl[kMaxFrames][CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t))];
+    std::memset(msgs, 0, sizeof(struct mmsghdr) * max);
+    for (int i = 0; i < max; ++i) {
+        iov[i].iov_base = &frames[i];
+        iov[i].iov_len = sizeof(struct can_frame);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = ctrl[i];
+        msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+    }
+
+    int n = recvmmsg(fd, msgs, max, MSG_DONTWAIT, nullptr);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+    if (n <= 0) return n;
+
+    int count = 0;
+    for (int i = 0; i < n; ++i) {
+        if (msgs[i].msg_len != sizeof(struct can_frame)) continue;
+        qint64 kns = 0;
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(&msgs[i].msg_hdr); c; c = CMSG_NXTHDR(&msgs[i].msg_hdr, c)) {
+            if (c->cmsg_level != SOL_SOCKET) continue;
+            if (c->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec kts;
+                std::memcpy(&kts, CMSG_DATA(c), sizeof(kts));
+                kns = qint64(kts.tv_sec) * 1000000000 + kts.tv_nsec;
+            } else if (c->cmsg_type == SO_RXQ_OVFL) {
+                // cumulative drop count of this socket at the time the frame was queued
+                uint32_t ovfl;
+                std::memcpy(&ovfl, CMSG_DATA(c), sizeof(ovfl));
+                if (ovfl != stats->lastOvfl) {
+                    stats->dropped.fetch_add(uint32_t(ovfl - stats->lastOvfl), std::memory_order_relaxed);
+                    stats->lastOvfl = ovfl;
+                }
+            }
+        }
+
+        const struct can_frame &frame = frames[i];
+        if (frame.can_id & CAN_ERR_FLAG) {
+            bool crtl = frame.can_id & CAN_ERR_CRTL;
+            if (crtl && (frame.data[1] & CAN_ERR_CRTL_RX_OVERFLOW))
+                stats->ctrlRxOverflow.fetch_add(1, std::memory_order_relaxed);
+            if (crtl && (frame.data[1] & CAN_ERR_CRTL_TX_OVERFLOW))
+                stats->ctrlTxOverflow.fetch_add(1, std::memory_order_relaxed);
+            if (crtl && (frame.data[1] & (CAN_ERR_CRTL_RX_PASSIVE | CAN_ERR_CRTL_TX_PASSIVE)))
+                stats->errorPassive.fetch_add(1, std::memory_order_relaxed);
+            if (frame.can_id & CAN_ERR_BUSOFF)
+                stats->busOff.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            stats->frames.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (count != i) frames[count] = frames[i];
+        kernelNs[count] = kns;
+        count++;
+    }
+    return count;
+}
+
+// ------------------------- CanManager -------------------------
 
 CanManager::CanManager(QObject *parent)
     : QObject(parent), socket_fd(-1), notifier(nullptr)
 {
+    // frameReceived is emitted from the RX thread in low-latency mode
+    qRegisterMetaType<uint32_t>("uint32_t");
+    qRegisterMetaType<can_frame>("can_frame");
 }
 
 CanManager::~CanManager()
@@ -24,34 +188,14 @@ bool CanManager::open(const std::string &ifname)
     QMutexLocker locker(&mtx);
     if (socket_fd >= 0) return true;
 
-    socket_fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    QString error;
+    socket_fd = openRawSocket(ifname, rcvbuf_size, sndbuf_size, &error, &rcvbuf_effective, &sndbuf_effective);
     if (socket_fd < 0) {
+        qWarning() << "CAN open failed:" << error;
         emit canStatusChanged(false);
         return false;
     }
-
-    struct ifreq ifr;
-    std::strncpy(ifr.ifr_name, ifname.c_str(), IFNAMSIZ-1);
-    ifr.ifr_name[IFNAMSIZ-1] = '\0';
-
-    if (ioctl(socket_fd, SIOCGIFINDEX, &ifr) < 0) {
-        ::close(socket_fd);
-        socket_fd = -1;
-        emit canStatusChanged(false);
-        return false;
-    }
-
-    struct sockaddr_can addr;
-    std::memset(&addr, 0, sizeof(addr));
-    addr.can_family = AF_CAN;
-    addr.can_ifindex = ifr.ifr_ifindex;
-
-    if (bind(socket_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
-        ::close(socket_fd);
-        socket_fd = -1;
-        emit canStatusChanged(false);
-        return false;
-    }
+    rx_stats.reset();
 
     notifier = new QSocketNotifier(socket_fd, QSocketNotifier::Read, this);
     connect(notifier, &QSocketNotifier::activated, this, &CanManager::onCanReadable);
@@ -62,6 +206,7 @@ bool CanManager::open(const std::string &ifname)
 
 void CanManager::close()
 {
+    stopLowLatency();
     QMutexLocker locker(&mtx);
     if (notifier) {
         notifier->setEnabled(false);
@@ -77,6 +222,87 @@ void CanManager::close()
 
 bool CanManager::isOpen() const { return socket_fd >= 0; }
 
+int CanManager::openRawSocket(const std::string &ifname, int rcvbuf, int sndbuf, QString *error,
+                              int *effRcv, int *effSnd)
+{
+    QString name = QString::fromStdString(ifname);
+    int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (fd < 0) {
+        if (error) *error = QString("socket() failed: %1").arg(strerror(errno));
+        return -1;
+    }
+
+    struct ifreq ifr;
+    std::memset(&ifr, 0, sizeof(ifr));
+    std::strncpy(ifr.ifr_name, ifname.c_str(), IFNAMSIZ - 1);
+    if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0) {
+        if (error) *error = QString("%1: %2").arg(name, strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+
+    struct sockaddr_can addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        if (error) *error = QString("bind %1: %2").arg(name, strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+
+    // kernel RX timestamps for the wake-up latency histograms
+    int on = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0) {
+        qWarning() << "SO_TIMESTAMPNS failed:" << strerror(errno);
+    }
+    // per-message count of frames the socket queue had to drop
+    if (setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) < 0) {
+        qWarning() << "SO_RXQ_OVFL failed:" << strerror(errno);
+    }
+    // controller state changes and overruns arrive as error frames
+    can_err_mask_t errMask = CAN_ERR_CRTL | CAN_ERR_BUSOFF | CAN_ERR_RESTARTED;
+    if (setsockopt(fd, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &errMask, sizeof(errMask)) < 0) {
+        qWarning() << "CAN_RAW_ERR_FILTER failed:" << strerror(errno);
+    }
+    tuneSocketBuffers(fd, rcvbuf, sndbuf, effRcv, effSnd);
+    return fd;
+}
+
+void CanManager::tuneSocketBuffers(int fd, int rcvbuf, int sndbuf, int *effRcv, int *effSnd)
+{
+    // the *FORCE variants ignore net.core.{r,w}mem_max but need CAP_NET_ADMIN
+    if (rcvbuf > 0 && setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0
+            && setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
+        qWarning() << "SO_RCVBUF failed:" << strerror(errno);
+    }
+    if (sndbuf > 0 && setsockopt(fd, SOL_SOCKET, SO_SNDBUFFORCE, &sndbuf, sizeof(sndbuf)) < 0
+            && setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0) {
+        qWarning() << "SO_SNDBUF failed:" << strerror(errno);
+    }
+    socklen_t len = sizeof(int);
+    if (effRcv) getsockopt(fd, SOL_SOCKET, SO_RCVBUF, effRcv, &len);
+    len = sizeof(int);
+    if (effSnd) getsockopt(fd, SOL_SOCKET, SO_SNDBUF, effSnd, &len);
+}
+
+bool CanManager::readIfCounters(const std::string &ifname, CanIfCounters *out)
+{
+    QString dir = QString("/sys/class/net/%1/statistics/").arg(QString::fromStdString(ifname));
+    auto read = [&dir](const char *name, quint64 *v) {
+        QFile f(dir + name);
+        if (!f.open(QIODevice::ReadOnly)) return false;
+        bool ok = false;
+        *v = f.readAll().trimmed().toULongLong(&ok);
+        return ok;
+    };
+    bool ok = read("rx_dropped", &out->rxDropped);
+    ok = read("rx_over_errors", &out->rxOverErrors) && ok;
+    ok = read("rx_errors", &out->rxErrors) && ok;
+    ok = read("tx_errors", &out->txErrors) && ok;
+    return ok;
+}
+
 bool CanManager::sendFrame(uint32_t can_id, const QByteArray &data)
 {
     QMutexLocker locker(&mtx);
@@ -98,12 +324,183 @@ bool CanManager::sendFrame(uint32_t can_id, const QByteArray &data)
     return true;
 }
 
+int CanManager::sendFrames(const struct can_frame *frames, int count)
+{
+    QMutexLocker locker(&mtx);
+    if (socket_fd < 0 || count <= 0) return 0;
+
+    int sent = 0;
+    while (sent < count) {
+        int chunk = qMin(count - sent, kCanBatch);
+        struct mmsghdr msgs[kCanBatch];
+        struct iovec iov[kCanBatch];
+        std::memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < chunk; ++i) {
+            iov[i].iov_base = const_cast<struct can_frame *>(&frames[sent + i]);
+            iov[i].iov_len = sizeof(struct can_frame);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = sendmmsg(socket_fd, msgs, chunk, 0);
+        if (n <= 0) {
+            qWarning() << "CAN sendmmsg failed:" << strerror(errno);
+            break;
+        }
+        sent += n;
+        if (n < chunk) break;   // TX queue full; caller decides whether to retry
+    }
+
+    QDateTime now = QDateTime::currentDateTime();
+    for (int i = 0; i < sent; ++i) {
+        const struct can_frame &f = frames[i];
+        emit frameSent(f.can_id & CAN_EFF_MASK,
+                       QByteArray(reinterpret_cast<const char *>(f.data), f.can_dlc), now);
+    }
+    return sent;
+}
+
 void CanManager::onCanReadable()
 {
-    struct can_frame frame;
-    ssize_t n = read(socket_fd, &frame, sizeof(frame));
-    if (n != sizeof(frame)) return;
-    QByteArray data(reinterpret_cast<const char *>(frame.data), frame.can_dlc);
-    uint32_t id = frame.can_id & CAN_EFF_MASK;
-    emit frameReceived(id, data, QDateTime::currentDateTime());
+    readBatch(nullptr);
+}
+
+// Drains up to kCanBatch frames in one recvmmsg, runs the reactive hook,
+// records kernel->user latency into *hist (if given) and emits the data
+// frames; drops and error frames are counted by CanRxBatch.
+int CanManager::readBatch(RxLatencyHistogram *hist)
+{
+    CanRxBatch batch;
+    int n = batch.read(socket_fd, &rx_stats, kCanBatch);
+    if (n <= 0) return n;
+    qint64 nowNs = clockNs(CLOCK_REALTIME);
+
+    // respond before anything else; this is the latency-critical part
+    if (reactive_hook) {
+        for (int i = 0; i < n; ++i) {
+            if (batch.frames[i].can_id & CAN_ERR_FLAG) continue;
+            struct can_frame tx;
+            std::memset(&tx, 0, sizeof(tx));
+            if (reactive_hook(batch.frames[i], &tx) && write(socket_fd, &tx, sizeof(tx)) != sizeof(tx))
+                qWarning() << "CAN reactive write failed:" << strerror(errno);
+        }
+    }
+
+    // frameReceived costs a QByteArray and a QDateTime per frame; only pay
+    // for it when someone listens
+    static const QMetaMethod frameSignal = QMetaMethod::fromSignal(&CanManager::frameReceived);
+    static const QMetaMethod canFrameSignal = QMetaMethod::fromSignal(&CanManager::canFrameReceived);
+    bool wantFrame = isSignalConnected(frameSignal);
+    bool wantCanFrame = isSignalConnected(canFrameSignal);
+    for (int i = 0; i < n; ++i) {
+        if (hist && batch.kernelNs[i]) hist->record(nowNs - batch.kernelNs[i]);
+        const struct can_frame &frame = batch.frames[i];
+        if (frame.can_id & CAN_ERR_FLAG) continue;
+        if (wantFrame) {
+            QByteArray data(reinterpret_cast<const char *>(frame.data), frame.can_dlc);
+            uint32_t id = frame.can_id & CAN_EFF_MASK;
+            qint64 tsNs = batch.kernelNs[i] ? batch.kernelNs[i] : nowNs;
+            emit frameReceived(id, data, QDateTime::fromMSecsSinceEpoch(tsNs / 1000000));
+        }
+        if (wantCanFrame) emit canFrameReceived(frame);
+    }
+    return n;
+}
+
+// ------------------------- low-latency RX -------------------------
+
+bool CanManager::startLowLatency(const LowLatencyOptions &opt)
+{
+    if (rx_thread) return true;
+    if (socket_fd < 0) return false;
+
+    busy_poll_prev = -1;
+    if (opt.busyPollUs > 0) {
+        int prev = 0;
+        socklen_t len = sizeof(prev);
+        if (getsockopt(socket_fd, SOL_SOCKET, SO_BUSY_POLL, &prev, &len) < 0) prev = 0;
+        int usec = opt.busyPollUs;
+        if (setsockopt(socket_fd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) < 0) {
+            // raising it above net.core.busy_read needs CAP_NET_ADMIN; spinning still works
+            qWarning() << "SO_BUSY_POLL failed:" << strerror(errno);
+        } else {
+            busy_poll_prev = prev;
+        }
+    }
+
+    if (notifier) notifier->setEnabled(false);
+    rx_stop.store(false);
+    spin_wakeups.store(0);
+    blocked_wakeups.store(0);
+    lat_busy.reset();
+    rx_thread = QThread::create([this, opt]() { rxLoop(opt); });
+    rx_thread->start(QThread::TimeCriticalPriority);
+    return true;
+}
+
+void CanManager::stopLowLatency()
+{
+    if (!rx_thread) return;
+    rx_stop.store(true);
+    rx_thread->wait();
+    delete rx_thread;
+    rx_thread = nullptr;
+    if (busy_poll_prev >= 0) {
+        // lowering it never needs privileges
+        if (setsockopt(socket_fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_prev, sizeof(busy_poll_prev)) < 0)
+            qWarning() << "Restoring SO_BUSY_POLL failed:" << strerror(errno);
+        busy_poll_prev = -1;
+    }
+    if (notifier) notifier->setEnabled(true);
+}
+
+void CanManager::rxLoop(LowLatencyOptions opt)
+{
+    if (opt.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(opt.cpu, &set);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc != 0) qWarning() << "Pinning RX thread to CPU" << opt.cpu << "failed:" << strerror(rc);
+    }
+
+    const qint64 spinNs = qint64(qMax(0, opt.spinUs)) * 1000;
+    qint64 lastNs = clockNs(CLOCK_MONOTONIC);
+    bool spinning = true;
+    while (!rx_stop.load(std::memory_order_relaxed)) {
+        if (readBatch(&lat_busy) > 0) {
+            (spinning ? spin_wakeups : blocked_wakeups).fetch_add(1, std::memory_order_relaxed);
+            spinning = true;
+            lastNs = clockNs(CLOCK_MONOTONIC);
+            continue;
+        }
+        if (spinning && clockNs(CLOCK_MONOTONIC) - lastNs < spinNs) {
+            cpuRelax();
+            continue;
+        }
+        // bus idle: stop burning the core until traffic resumes
+        spinning = false;
+        struct pollfd pfd;
+        pfd.fd = socket_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        poll(&pfd, 1, 100);   // bounded so rx_stop is noticed
+    }
+}
+
+void CanManager::setReactiveHook(const ReactiveHook &hook)
+{
+    if (rx_thread) {
+        qWarning() << "setReactiveHook ignored while low-latency RX is running";
+        return;
+    }
+    reactive_hook = hook;
+}
+
+QString CanManager::latencyReport() const
+{
+    QString s = lat_busy.report("busy");
+    quint64 spin = spin_wakeups.load(std::memory_order_relaxed);
+    quint64 blocked = blocked_wakeups.load(std::memory_order_relaxed);
+    if (spin + blocked > 0) s += QString(" (wakeups spin %1 / blocked %2)").arg(spin).arg(blocked);
+    return s;
 }
@@ -4,6 +4,81 @@
 #include <QDateTime>
 #include <QMutex>
 #include <QSocketNotifier>
+#include <QString>
+#include <atomic>
+#include <functional>
+#include <linux/can.h>
+
+class QThread;
+
+// Receive latency histogram: kernel RX timestamp -> frame handled in user
+// space, in power-of-two microsecond buckets. Written by one RX context,
+// read from the GUI thread.
+struct RxLatencyHistogram
+{
+    enum { kBuckets = 24 };
+    std::atomic<quint64> buckets[kBuckets];
+    std::atomic<quint64> count;
+    std::atomic<quint64> maxNs;
+
+    RxLatencyHistogram() { reset(); }
+    void reset();
+    void record(qint64 ns);
+    quint64 percentileUs(double p) const;   // upper bound of the bucket holding p
+    QString report(const QString &name) const;   // "name n=.. p50<=.. p99<=.. max=.. us"
+};
+
+// netdev statistics of a CAN interface (/sys/class/net/<if>/statistics)
+struct CanIfCounters
+{
+    quint64 rxDropped = 0;
+    quint64 rxOverErrors = 0;   // controller FIFO overruns on most CAN drivers
+    quint64 rxErrors = 0;
+    quint64 txErrors = 0;
+};
+
+// Receive counters of one raw CAN socket, cumulative since the socket was
+// opened: frames, frames lost to socket queue overflow (SO_RXQ_OVFL) and
+// controller error frames.
+struct CanRxCounters
+{
+    quint64 frames = 0;
+    quint64 dropped = 0;
+    quint64 ctrlRxOverflow = 0;
+    quint64 ctrlTxOverflow = 0;
+    quint64 errorPassive = 0;
+    quint64 busOff = 0;
+};
+
+// The same counters while they are being updated: written by the one
+// context reading the socket, snapshot() is safe from any thread.
+struct CanRxStats
+{
+    std::atomic<quint64> frames{0};
+    std::atomic<quint64> dropped{0};
+    std::atomic<quint64> ctrlRxOverflow{0};
+    std::atomic<quint64> ctrlTxOverflow{0};
+    std::atomic<quint64> errorPassive{0};
+    std::atomic<quint64> busOff{0};
+    uint32_t lastOvfl = 0;   // reader only; SO_RXQ_OVFL is a running count
+
+    void reset();
+    CanRxCounters snapshot() const;
+};
+
+// One recvmmsg(MSG_DONTWAIT) from a socket opened with
+// CanManager::openRawSocket(). Queue drops and error frames are accounted
+// in the given CanRxStats; frames[] holds every complete frame read, error
+// frames included (CAN_ERR_FLAG), with its kernel RX time in kernelNs[].
+struct CanRxBatch
+{
+    enum { kMaxFrames = 64 };
+    struct can_frame frames[kMaxFrames];
+    qint64 kernelNs[kMaxFrames];   // CLOCK_REALTIME, 0 if none was delivered
+
+    // returns the number of frames in frames[], or -1 with errno set
+    int read(int fd, CanRxStats *stats, int maxFrames = kMaxFrames);
+};
 
 class CanManager : public QObject
 {
@@ -16,18 +91,81 @@ public:
     void close();
     bool isOpen() const;
 
+    // SO_RCVBUF / SO_SNDBUF in bytes for the next open(); 0 keeps the default
+    void setSocketBuffers(int rcvbuf, int sndbuf) { rcvbuf_size = rcvbuf; sndbuf_size = sndbuf; }
+    // what the kernel actually granted at open() (capped by rmem_max, doubled)
+    int effectiveRcvbuf() const { return rcvbuf_effective; }
+    int effectiveSndbuf() const { return sndbuf_effective; }
+    // Raw CAN socket bound to ifname, as every socket in the app is set up:
+    // SO_RXQ_OVFL and SO_TIMESTAMPNS for CanRxBatch, controller error
+    // frames (CAN_ERR_CRTL / BUSOFF / RESTARTED) and tuned buffers.
+    // Returns the fd or -1 with *error set.
+    static int openRawSocket(const std::string &ifname, int rcvbuf, int sndbuf, QString *error,
+                             int *effRcv = nullptr, int *effSnd = nullptr);
+    // applies the sizes to fd (SO_*BUFFORCE when privileged) and returns what the kernel granted
+    static void tuneSocketBuffers(int fd, int rcvbuf, int sndbuf, int *effRcv, int *effSnd);
+    static bool readIfCounters(const std::string &ifname, CanIfCounters *out);
+
+    CanRxCounters rxCounters() const { return rx_stats.snapshot(); }
+
     bool sendFrame(uint32_t can_id, const QByteArray &data);
+    // batched write via sendmmsg; returns number of frames written
+    int sendFrames(const struct can_frame *frames, int count);
+
+    // Low-latency RX: a dedicated thread spins on recvmmsg(MSG_DONTWAIT),
+    // optionally pinned to `cpu` and with SO_BUSY_POLL, and falls back to a
+    // blocking poll() once the bus has been idle for `spinUs`.
+    struct LowLatencyOptions {
+        int cpu = -1;          // -1 = no pinning
+        int busyPollUs = 0;    // 0 = leave SO_BUSY_POLL alone; restored on stop
+        int spinUs = 500;
+    };
+    bool startLowLatency(const LowLatencyOptions &opt);
+    void stopLowLatency();
+    bool isLowLatency() const { return rx_thread != nullptr; }
+
+    // Called for every received frame before it is emitted, from whichever
+    // context reads the socket (the RX thread in low-latency mode). Return
+    // true with *tx filled to send a response immediately from that context.
+    // Set only while low-latency mode is stopped.
+    typedef std::function<bool(const struct can_frame &rx, struct can_frame *tx)> ReactiveHook;
+    void setReactiveHook(const ReactiveHook &hook);
+
+    // wake-up latency of the low-latency RX thread since it was started; the
+    // notifier path is measured on the GUI socket (MainWindow's "wake")
+    QString latencyReport() const;
 
 signals:
     void canStatusChanged(bool ok);
     void frameSent(uint32_t id, const QByteArray &data, const QDateTime &ts);
     void frameReceived(uint32_t id, const QByteArray &data, const QDateTime &ts);
+    // the same frames with can_id untouched (EFF/RTR flags kept), for bridging
+    void canFrameReceived(const struct can_frame &frame);
 
 private slots:
     void onCanReadable();
 
 private:
+    int readBatch(RxLatencyHistogram *hist);
+    void rxLoop(LowLatencyOptions opt);
+
     int socket_fd = -1;
     QMutex mtx;
     QSocketNotifier *notifier = nullptr;
+    int rcvbuf_size = 0;
+    int sndbuf_size = 0;
+    int rcvbuf_effective = 0;
+    int sndbuf_effective = 0;
+
+    CanRxStats rx_stats;
+
+    QThread *rx_thread = nullptr;
+    std::atomic<bool> rx_stop{false};
+    std::atomic<quint64> spin_wakeups{0};
+    std::atomic<quint64> blocked_wakeups{0};
+    int busy_poll_prev = -1;      // SO_BUSY_POLL before startLowLatency, -1 = untouched
+    ReactiveHook reactive_hook;
+    RxLatencyHistogram lat_busy;
 };
+
+Q_DECLARE_METATYPE(can_frame)
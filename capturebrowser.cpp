@@ -0,0 +1,222 @@
+#include "capturebrowser.h"
+#include "ui_capturebrowser.h"
+
+#include <climits>
+#include <linux/can.h>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QThread>
+
+// ------------------------- model -------------------------
+
+CaptureLogModel::CaptureLogModel(CaptureIndex *index, QObject *parent)
+    : QAbstractTableModel(parent), m_index(index)
+{
+}
+
+void CaptureLogModel::reload()
+{
+    beginResetModel();
+    endResetModel();
+}
+
+int CaptureLogModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return int(qMin<qint64>(m_index->rowCount(), INT_MAX));
+}
+
+int CaptureLogModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return 5;
+}
+
+QVariant CaptureLogModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) return QVariant();
+    static const char *names[] = { "Dir", "Time", "CAN ID", "DLC", "Data" };
+    if (section < 0 || section >= 5) return QVariant();
+    return QString(names[section]);
+}
+
+QVariant CaptureLogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || role != Qt::DisplayRole) return QVariant();
+
+    CaptureIndex::Line line = m_index->row(index.row());
+    if (!line.begin) return QVariant();
+    qint64 ts;
+    uint32_t key;
+    if (!CaptureIndex::parseLine(line.begin, line.begin + line.len, &ts, &key)) return QVariant();
+
+    // "(ts) ifname ID#DATA [R|T]"
+    QList<QByteArray> tok = QByteArray::fromRawData(line.begin, line.len).split(' ');
+    QByteArray frame = tok.value(2);
+    int hash = frame.indexOf('#');
+    QByteArray payload = frame.mid(hash + 1);
+    bool rtr = payload.startsWith('R');
+
+    switch (index.column()) {
+    case 0:
+        return tok.value(3) == "T" ? QString("TX") : QString("RX");
+    case 1:
+        return QDateTime::fromMSecsSinceEpoch(ts / 1000).toString("HH:mm:ss.zzz");
+    case 2:
+        if (key & CAN_ERR_FLAG) return QString::asprintf("ERR 0x%08X", key & CAN_ERR_MASK);
+        if (key & CAN_EFF_FLAG) return QString::asprintf("0x%08X", key & CAN_EFF_MASK);
+        return QString::asprintf("0x%03X", key);
+    case 3:
+        return rtr ? 0 : payload.size() / 2;
+    case 4: {
+        if (rtr) return QString("RTR");
+        QString dataStr;
+        for (int i = 0; i + 1 < payload.size(); i += 2) {
+            dataStr += QLatin1String(payload.constData() + i, 2);
+            dataStr += ' ';
+        }
+        return dataStr.trimmed();
+    }
+    }
+    return QVariant();
+}
+
+// ------------------------- dialog -------------------------
+
+CaptureBrowser::CaptureBrowser(QWidget *parent)
+    : QDialog(parent),
+      ui(new Ui::CaptureBrowser)
+{
+    ui->setupUi(this);
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    // the model is attached once the index is ready (onOpenFinished)
+    m_model = new CaptureLogModel(&m_index, this);
+    ui->tableView->verticalHeader()->setVisible(false);
+    ui->tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->tableView->verticalHeader()->setDefaultSectionSize(20);
+    ui->tableView->horizontalHeader()->setStretchLastSection(true);
+
+    connect(ui->btnGoto, &QPushButton::clicked, this, &CaptureBrowser::onGotoClicked);
+    connect(ui->editGoto, &QLineEdit::returnPressed, this, &CaptureBrowser::onGotoClicked);
+    connect(ui->btnFilter, &QPushButton::clicked, this, &CaptureBrowser::onFilterClicked);
+    connect(ui->editFilter, &QLineEdit::returnPressed, this, &CaptureBrowser::onFilterClicked);
+    connect(ui->btnClearFilter, &QPushButton::clicked, this, &CaptureBrowser::onClearFilterClicked);
+
+    m_progressTimer.setSingleShot(false);
+    connect(&m_progressTimer, &QTimer::timeout, this, [this]() {
+        emit indexProgress(m_index.buildProgress());
+    });
+}
+
+CaptureBrowser::~CaptureBrowser()
+{
+    if (m_openThread) {
+        // don't sit out a multi-GB index build on the way out
+        m_index.abort();
+        m_openThread->wait();
+        delete m_openThread;
+    }
+    delete ui;
+}
+
+void CaptureBrowser::openLog(const QString &path)
+{
+    if (m_openThread) return;
+    m_openPath = path;
+    m_openThread = QThread::create([this, path]() {
+        QElapsedTimer t;
+        t.start();
+        m_openOk = m_index.open(path, &m_openError);
+        m_openMs = t.elapsed();
+    });
+    connect(m_openThread, &QThread::finished, this, &CaptureBrowser::onOpenFinished);
+    m_openThread->start(QThread::LowPriority);
+    m_progressTimer.start(200);
+}
+
+void CaptureBrowser::onOpenFinished()
+{
+    m_progressTimer.stop();
+    m_openThread->wait();
+    delete m_openThread;
+    m_openThread = nullptr;
+    if (!m_openOk) {
+        emit openFailed(m_openError);
+        return;
+    }
+    ui->tableView->setModel(m_model);
+    setWindowTitle(QString("Capture - %1").arg(QFileInfo(m_openPath).fileName()));
+    updateInfo(QString("index %1 in %2 ms").arg(m_index.builtIndex() ? "built" : "loaded").arg(m_openMs));
+    emit logOpened();
+}
+
+void CaptureBrowser::updateInfo(const QString &extra)
+{
+    QString s = QString("%1 frames, %2 IDs").arg(m_index.totalLines()).arg(m_index.idCount());
+    if (m_index.hasFilter()) s += QString(", %1 shown").arg(m_index.rowCount());
+    if (!extra.isEmpty()) s += ", " + extra;
+    ui->lblInfo->setText(s);
+}
+
+void CaptureBrowser::onGotoClicked()
+{
+    // accepts epoch seconds ("1690000000.25") or a time of day on the
+    // date of the first frame ("14:03:12.500")
+    QString text = ui->editGoto->text().trimmed();
+    if (text.isEmpty() || m_index.rowCount() == 0) return;
+
+    qint64 tsUs;
+    if (text.contains(':')) {
+        QTime tod = QTime::fromString(text, text.contains('.') ? "H:mm:ss.zzz" : "H:mm:ss");
+        if (!tod.isValid()) { updateInfo("invalid time"); return; }
+        CaptureIndex::Line first = m_index.row(0);
+        qint64 firstTs;
+        uint32_t key;
+        if (!CaptureIndex::parseLine(first.begin, first.begin + first.len, &firstTs, &key)) return;
+        QDate day = QDateTime::fromMSecsSinceEpoch(firstTs / 1000).date();
+        tsUs = QDateTime(day, tod).toMSecsSinceEpoch() * 1000;
+    } else {
+        bool ok = false;
+        double sec = text.toDouble(&ok);
+        if (!ok) { updateInfo("invalid time"); return; }
+        tsUs = qint64(sec * 1e6);
+    }
+
+    QElapsedTimer t;
+    t.start();
+    qint64 row = m_index.rowForTime(tsUs);
+    double ms = t.nsecsElapsed() / 1e6;
+    if (row < 0) return;
+    QModelIndex idx = m_model->index(int(qMin<qint64>(row, INT_MAX)), 0);
+    ui->tableView->scrollTo(idx, QAbstractItemView::PositionAtTop);
+    ui->tableView->setCurrentIndex(idx);
+    updateInfo(QString("seek %1 ms").arg(ms, 0, 'f', 2));
+}
+
+void CaptureBrowser::onFilterClicked()
+{
+    QString s = ui->editFilter->text().trimmed();
+    if (s.startsWith("0x") || s.startsWith("0X")) s = s.mid(2);
+    bool ok = false;
+    uint32_t id = s.toUInt(&ok, 16);
+    if (!ok || s.isEmpty()) { updateInfo("invalid ID"); return; }
+    // same rule as candump: more than three digits means a 29-bit id,
+    // and 2xxxxxxx an error frame of that class
+    uint32_t key = CaptureIndex::keyForId(id, s.size());
+
+    QElapsedTimer t;
+    t.start();
+    m_index.setFilter(key);
+    m_model->reload();
+    updateInfo(QString("filter %1 ms").arg(t.nsecsElapsed() / 1e6, 0, 'f', 2));
+}
+
+void CaptureBrowser::onClearFilterClicked()
+{
+    m_index.clearFilter();
+    m_model->reload();
+    updateInfo();
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <QAbstractTableModel>
+#include <QDialog>
+#include <QTimer>
+#include "captureindex.h"
+
+class QThread;
+
+namespace Ui { class CaptureBrowser; }
+
+// Virtualized view over a CaptureIndex: rows are decoded from the mapped
+// log only when the view asks for them.
+class CaptureLogModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit CaptureLogModel(CaptureIndex *index, QObject *parent = nullptr);
+
+    void reload();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    CaptureIndex *m_index;
+};
+
+class CaptureBrowser : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit CaptureBrowser(QWidget *parent = nullptr);
+    ~CaptureBrowser();
+
+    // Opens (and if needed indexes) the log on a worker thread so the
+    // caller's event loop, and with it CAN RX, keeps running. Ends with
+    // logOpened() or openFailed(); the dialog is not usable before.
+    void openLog(const QString &path);
+
+signals:
+    void indexProgress(int percent);
+    void logOpened();
+    void openFailed(const QString &error);
+
+private slots:
+    void onGotoClicked();
+    void onFilterClicked();
+    void onClearFilterClicked();
+    void onOpenFinished();
+
+private:
+    void updateInfo(const QString &extra = QString());
+
+    Ui::CaptureBrowser *ui;
+    CaptureIndex m_index;
+    CaptureLogModel *m_model = nullptr;
+
+    QThread *m_openThread = nullptr;
+    QTimer m_progressTimer;
+    QString m_openPath;
+    bool m_openOk = false;
+    QString m_openError;
+    qint64 m_openMs = 0;
+};
@@ -0,0 +1,322 @@
+#include "capturebuffer.h"
+
+#include <cstring>
+#include <cstdio>
+#include <utility>
+#include <time.h>
+#include <linux/can.h>
+#include <linux/can/error.h>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QThread>
+
+static qint64 realtimeUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static const char *triggerName(CaptureBuffer::TriggerType type)
+{
+    switch (type) {
+    case CaptureBuffer::TriggerId: return "id";
+    case CaptureBuffer::TriggerPayload: return "payload";
+    case CaptureBuffer::TriggerBusOff: return "bus-off";
+    case CaptureBuffer::TriggerManual: return "manual";
+    }
+    return "?";
+}
+
+CaptureBuffer::CaptureBuffer(QObject *parent)
+    : QObject(parent)
+{
+    m_postTimer.setSingleShot(true);
+    connect(&m_postTimer, &QTimer::timeout, this, &CaptureBuffer::onPostTimeout);
+}
+
+CaptureBuffer::~CaptureBuffer()
+{
+    waitForSave();
+}
+
+void CaptureBuffer::waitForSave()
+{
+    if (!m_saveThread) return;
+    m_saveThread->wait();
+    delete m_saveThread;
+    m_saveThread = nullptr;
+}
+
+void CaptureBuffer::configure(int preSeconds, int postSeconds, int bitrate,
+                              const QString &dir, const QString &ifname)
+{
+    m_preSeconds = qMax(1, preSeconds);
+    m_postSeconds = qMax(0, postSeconds);
+    m_dir = dir;
+    m_ifname = ifname;
+
+    // worst case: back-to-back minimal frames for the whole window
+    quint64 fps = quint64(qMax(bitrate, 10000)) / kMinFrameBits + 1;
+    quint64 need = fps * quint64(m_preSeconds + m_postSeconds);
+    quint64 cap = 1;
+    while (cap < need) cap <<= 1;
+
+    // the save thread may still be reading the second ring
+    waitForSave();
+    m_ring.assign(cap, Record());
+    m_saveRing.assign(cap, Record());
+    m_mask = cap - 1;
+    m_written = 0;
+}
+
+void CaptureBuffer::setLimits(int holdoffSeconds, int maxMegabytes)
+{
+    m_holdoffSeconds = holdoffSeconds;
+    m_maxBytes = qint64(qMax(0, maxMegabytes)) * 1024 * 1024;
+}
+
+qint64 CaptureBuffer::captureBytesOnDisk() const
+{
+    // our own captures plus the browser's sidecars next to them
+    qint64 total = 0;
+    const QFileInfoList files = QDir(m_dir).entryInfoList(QStringList() << "capture_*.log*", QDir::Files);
+    for (const QFileInfo &fi : files) total += fi.size();
+    return total;
+}
+
+void CaptureBuffer::setTriggers(const QVector<Trigger> &triggers)
+{
+    m_triggerCount = qMin(triggers.size(), int(kMaxTriggers));
+    for (int i = 0; i < m_triggerCount; ++i) m_triggers[i] = triggers[i];
+}
+
+void CaptureBuffer::arm()
+{
+    if (m_ring.empty()) return;
+    m_written = 0;
+    m_holdoffUntilUs = 0;
+    m_fullReported = false;
+    m_diskBytes.store(m_maxBytes > 0 ? captureBytesOnDisk() : 0);
+    m_state = Armed;
+}
+
+void CaptureBuffer::disarm()
+{
+    m_postTimer.stop();
+    m_state = Disarmed;
+}
+
+void CaptureBuffer::triggerManual()
+{
+    if (m_state == Armed) fire(TriggerManual, realtimeUs());
+}
+
+void CaptureBuffer::push(qint64 tsUs, const struct can_frame &frame, bool tx)
+{
+    if (m_state == Disarmed) return;
+
+    Record &r = m_ring[m_written & m_mask];
+    m_written++;
+    r.tsUs = tsUs;
+    r.canId = frame.can_id;
+    r.dlc = frame.can_dlc > 8 ? 8 : frame.can_dlc;
+    r.tx = tx ? 1 : 0;
+    uint64_t data = 0;
+    std::memcpy(&data, frame.data, r.dlc);
+    std::memcpy(r.data, &data, 8);
+
+    // only received traffic (and controller errors) can fire a trigger
+    if (m_state != Armed || tx || tsUs < m_holdoffUntilUs) return;
+
+    // error frames carry error classes in can_id; only bus-off may fire
+    if (frame.can_id & CAN_ERR_FLAG) {
+        if (!(frame.can_id & CAN_ERR_BUSOFF)) return;
+        for (int i = 0; i < m_triggerCount; ++i) {
+            if (m_triggers[i].type == TriggerBusOff) { fire(TriggerBusOff, tsUs); return; }
+        }
+        return;
+    }
+
+    // bytes beyond the DLC are padding, not payload; leave them out of the compare
+    uint8_t present[8] = {0};
+    std::memset(present, 0xFF, r.dlc);
+    uint64_t dlcMask;
+    std::memcpy(&dlcMask, present, 8);
+
+    uint32_t id = frame.can_id & CAN_EFF_MASK;
+    for (int i = 0; i < m_triggerCount; ++i) {
+        const Trigger &t = m_triggers[i];
+        if (t.type != TriggerId && t.type != TriggerPayload) continue;
+        if ((id ^ t.id) & t.idMask) continue;
+        if (t.type == TriggerPayload) {
+            uint64_t mask, value;
+            std::memcpy(&mask, t.dataMask, 8);
+            std::memcpy(&value, t.dataValue, 8);
+            // a pattern lying entirely past the DLC has nothing to compare
+            if (mask != 0 && (mask & dlcMask) == 0) continue;
+            mask &= dlcMask;
+            if ((data ^ value) & mask) continue;
+        }
+        fire(t.type, tsUs);
+        return;
+    }
+}
+
+void CaptureBuffer::fire(TriggerType type, qint64 tsUs)
+{
+    // the second ring is still being written out; this window can't be kept
+    if (m_saveThread && !m_saveThread->isFinished()) return;
+    if (m_maxBytes > 0 && m_diskBytes.load(std::memory_order_relaxed) >= m_maxBytes) {
+        if (!m_fullReported) {
+            m_fullReported = true;
+            emit captureError(QString("%1 holds %2 MiB of captures (limit %3 MiB); triggers ignored")
+                              .arg(m_dir).arg(m_diskBytes.load() >> 20).arg(m_maxBytes >> 20));
+        }
+        return;
+    }
+    m_state = PostTrigger;
+    m_triggerType = type;
+    m_triggerTsUs = tsUs;
+    emit triggered(QString::fromLatin1(triggerName(type)));
+    m_postTimer.start(m_postSeconds * 1000);
+}
+
+void CaptureBuffer::onPostTimeout()
+{
+    if (m_state != PostTrigger) return;
+    saveCapture();
+    // re-arm into the other (empty) ring; after the hold-off, which defaults
+    // to the pre-trigger time, the next window has full pre-trigger data again
+    m_state = Armed;
+    int holdoff = m_holdoffSeconds < 0 ? m_preSeconds : m_holdoffSeconds;
+    m_holdoffUntilUs = realtimeUs() + qint64(holdoff) * 1000000;
+}
+
+void CaptureBuffer::saveCapture()
+{
+    QString name = QString("capture_%1_%2.log")
+            .arg(QDateTime::fromMSecsSinceEpoch(m_triggerTsUs / 1000).toString("yyyyMMdd_HHmmss"))
+            .arg(triggerName(m_triggerType));
+    QString path = QDir(m_dir).filePath(name);
+    qint64 fromUs = m_triggerTsUs - qint64(m_preSeconds) * 1000000;
+    qint64 toUs = m_triggerTsUs + qint64(m_postSeconds) * 1000000;
+    QByteArray ifname = m_ifname.toLocal8Bit();
+
+    // hand the filled ring to the save thread and keep recording into the
+    // other one; fire() makes sure the previous save has finished
+    waitForSave();
+    m_ring.swap(m_saveRing);
+    m_saveWritten = m_written;
+    m_written = 0;
+
+    QString dir = m_dir;
+    quint64 written = m_saveWritten;
+    m_saveThread = QThread::create([this, dir, path, ifname, fromUs, toUs, written]() {
+        QDir().mkpath(dir);
+        QString error;
+        int frames = writeCapture(path, ifname, m_saveRing, written, fromUs, toUs, &error);
+        // queued to the owner's thread
+        if (frames < 0) {
+            emit captureError(error);
+            return;
+        }
+        m_diskBytes.fetch_add(QFileInfo(path).size());
+        emit captureSaved(path, frames);
+    });
+    m_saveThread->start(QThread::LowPriority);
+}
+
+// candump log format: (sec.usec) ifname ID#DATA, with R/T direction suffix.
+// Returns the number of frames written or -1 with *error set.
+int CaptureBuffer::writeCapture(const QString &path, const QByteArray &ifname,
+                                const std::vector<Record> &ring, quint64 written,
+                                qint64 fromUs, qint64 toUs, QString *error)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = QString("cannot write %1: %2").arg(path, f.errorString());
+        return -1;
+    }
+
+    QByteArray out;
+    out.reserve(1 << 20);
+    int frames = 0;
+    char line[96];
+    quint64 cap = ring.size();
+    for (quint64 i = written > cap ? written - cap : 0; i < written; ++i) {
+        const Record &r = ring[i & (cap - 1)];
+        if (r.tsUs < fromUs || r.tsUs > toUs) continue;
+        int n = std::snprintf(line, sizeof(line), "(%lld.%06lld) %s ",
+                              (long long)(r.tsUs / 1000000), (long long)(r.tsUs % 1000000),
+                              ifname.constData());
+        if (r.canId & CAN_ERR_FLAG)
+            n += std::snprintf(line + n, sizeof(line) - n, "%08X#", r.canId & (CAN_ERR_MASK | CAN_ERR_FLAG));
+        else if (r.canId & CAN_EFF_FLAG)
+            n += std::snprintf(line + n, sizeof(line) - n, "%08X#", r.canId & CAN_EFF_MASK);
+        else
+            n += std::snprintf(line + n, sizeof(line) - n, "%03X#", r.canId & CAN_SFF_MASK);
+        if (r.canId & CAN_RTR_FLAG) {
+            line[n++] = 'R';
+        } else {
+            for (int b = 0; b < r.dlc; ++b)
+                n += std::snprintf(line + n, sizeof(line) - n, "%02X", r.data[b]);
+        }
+        n += std::snprintf(line + n, sizeof(line) - n, " %c\n", r.tx ? 'T' : 'R');
+        out.append(line, n);
+        frames++;
+        if (out.size() > (1 << 20) - 128) {
+            f.write(out);
+            out.clear();
+        }
+    }
+    f.write(out);
+    f.close();
+    return frames;
+}
+
+// Trigger specs (settings.json "capture_triggers"):
+//   id:<id>[/<idmask>]
+//   data:<id>[/<idmask>]:<hexvalue>[/<hexmask>]
+//   busoff
+bool CaptureBuffer::parseTrigger(const QString &spec, Trigger *out)
+{
+    QStringList parts = spec.trimmed().split(':');
+    QString kind = parts.value(0).toLower();
+    Trigger t;
+
+    if (kind == "busoff" && parts.size() == 1) {
+        t.type = TriggerBusOff;
+        *out = t;
+        return true;
+    }
+    if ((kind != "id" || parts.size() != 2) && (kind != "data" || parts.size() != 3))
+        return false;
+
+    bool ok = false;
+    QStringList idParts = parts[1].split('/');
+    t.id = idParts[0].toUInt(&ok, 16);
+    if (!ok) return false;
+    t.idMask = CAN_EFF_MASK;
+    if (idParts.size() > 1) {
+        t.idMask = idParts[1].toUInt(&ok, 16);
+        if (!ok) return false;
+    }
+    t.type = TriggerId;
+
+    if (kind == "data") {
+        QStringList dataParts = parts[2].split('/');
+        QByteArray value = QByteArray::fromHex(dataParts[0].toLatin1());
+        QByteArray mask = dataParts.size() > 1 ? QByteArray::fromHex(dataParts[1].toLatin1())
+                                               : QByteArray(value.size(), char(0xFF));
+        if (value.isEmpty() || value.size() > 8 || mask.size() > 8) return false;
+        std::memcpy(t.dataValue, value.constData(), value.size());
+        std::memcpy(t.dataMask, mask.constData(), mask.size());
+        t.type = TriggerPayload;
+    }
+    *out = t;
+    return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include <vector>
+
+struct can_frame;
+class QThread;
+
+// Pre/post-trigger recorder. While armed every frame goes into a
+// preallocated ring sized for (pre + post) seconds at the worst-case bus
+// rate; when a trigger fires the ring keeps recording for `post` seconds
+// and then the window [trigger - pre, trigger + post] is written to disk
+// as a candump log, after which the buffer re-arms.
+//
+// push() runs in the RX path: it copies into the ring and evaluates the
+// triggers without allocating. Saving swaps the filled ring with a second,
+// preallocated one and formats/writes it on a worker thread, so recording
+// continues while the file is written. To stay armed for days, triggers
+// are ignored for a hold-off after each capture, while a file is still
+// being written, and once the capture directory holds the configured
+// amount of captures.
+class CaptureBuffer : public QObject
+{
+    Q_OBJECT
+public:
+    enum TriggerType { TriggerId, TriggerPayload, TriggerBusOff, TriggerManual };
+
+    struct Trigger {
+        TriggerType type = TriggerId;
+        uint32_t id = 0;
+        uint32_t idMask = 0;     // 0 matches any id
+        uint8_t dataMask[8] = {0};
+        uint8_t dataValue[8] = {0};
+    };
+
+    explicit CaptureBuffer(QObject *parent = nullptr);
+    ~CaptureBuffer();
+
+    // (re)allocates the rings; drops anything recorded so far
+    void configure(int preSeconds, int postSeconds, int bitrate,
+                   const QString &dir, const QString &ifname);
+    // holdoffSeconds after a capture before the next trigger can fire;
+    // maxMegabytes of capture_* files in dir, 0 = unlimited
+    void setLimits(int holdoffSeconds, int maxMegabytes);
+    void setTriggers(const QVector<Trigger> &triggers);
+
+    void arm();
+    void disarm();
+    bool isArmed() const { return m_state != Disarmed; }
+    bool isTriggered() const { return m_state == PostTrigger; }
+
+    void triggerManual();
+
+    // RX/TX path
+    void push(qint64 tsUs, const struct can_frame &frame, bool tx);
+
+    static bool parseTrigger(const QString &spec, Trigger *out);
+
+signals:
+    void triggered(const QString &reason);
+    void captureSaved(const QString &path, int frames);
+    void captureError(const QString &msg);
+
+private slots:
+    void onPostTimeout();
+
+private:
+    enum State { Disarmed, Armed, PostTrigger };
+    enum { kMaxTriggers = 8, kMinFrameBits = 47 };
+
+    struct Record {
+        qint64 tsUs;
+        uint32_t canId;      // raw can_id including EFF/RTR/ERR flags
+        uint8_t dlc;
+        uint8_t tx;
+        uint8_t pad[2];
+        uint8_t data[8];
+    };
+
+    void fire(TriggerType type, qint64 tsUs);
+    void saveCapture();
+    void waitForSave();
+    qint64 captureBytesOnDisk() const;
+    static int writeCapture(const QString &path, const QByteArray &ifname,
+                            const std::vector<Record> &ring, quint64 written,
+                            qint64 fromUs, qint64 toUs, QString *error);
+
+    std::vector<Record> m_ring;
+    quint64 m_mask = 0;
+    quint64 m_written = 0;
+    // ring handed to the save thread; only touched again once it finished
+    std::vector<Record> m_saveRing;
+    quint64 m_saveWritten = 0;
+
+    Trigger m_triggers[kMaxTriggers];
+    int m_triggerCount = 0;
+
+    State m_state = Disarmed;
+    qint64 m_triggerTsUs = 0;
+    TriggerType m_triggerType = TriggerManual;
+    QTimer m_postTimer;
+    QThread *m_saveThread = nullptr;
+
+    qint64 m_holdoffUntilUs = 0;
+    int m_holdoffSeconds = -1;           // -1 = same as preSeconds
+    qint64 m_maxBytes = 0;
+    std::atomic<qint64> m_diskBytes{0};  // capture files in m_dir, updated by the save thread
+    bool m_fullReported = false;
+
+    int m_preSeconds = 30;
+    int m_postSeconds = 10;
+    QString m_dir;
+    QString m_ifname;
+};
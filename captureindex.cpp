@@ -0,0 +1,435 @@
+#include "captureindex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <linux/can.h>
+#include <QFileInfo>
+#include <QThread>
+#include <QDebug>
+
+// 02: error frames keyed by CAN_ERR_FLAG instead of as 29-bit ids
+static const char kMagic[8] = { 'C', 'A', 'N', 'I', 'D', 'X', '0', '2' };
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+CaptureIndex::CaptureIndex()
+{
+    m_lineCache.setMaxCost(64 << 20);
+}
+
+CaptureIndex::~CaptureIndex()
+{
+    close();
+}
+
+void CaptureIndex::close()
+{
+    if (m_data) m_file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(m_data)));
+    m_data = nullptr;
+    m_file.close();
+    m_size = 0;
+    m_blocks.clear();
+    m_postings.clear();
+    m_totalLines = 0;
+    m_blocksTotal.store(0);
+    m_blocksDone.store(0);
+    m_lineCache.clear();
+    clearFilter();
+}
+
+bool CaptureIndex::open(const QString &path, QString *error)
+{
+    close();
+    m_abort.store(false);
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+    m_size = quint64(m_file.size());
+    m_mtimeMs = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+    if (m_size == 0) {
+        if (error) *error = "empty file";
+        m_file.close();
+        return false;
+    }
+    m_data = reinterpret_cast<const char *>(m_file.map(0, qint64(m_size)));
+    if (!m_data) {
+        if (error) *error = QString("mmap failed: %1").arg(m_file.errorString());
+        m_file.close();
+        return false;
+    }
+
+    QString sidecar = path + ".idx";
+    m_built = !loadSidecar(sidecar);
+    if (m_built) {
+        if (!build()) {
+            if (error) *error = "cancelled";
+            close();
+            return false;
+        }
+        saveSidecar(sidecar);   // best effort; read-only media just rebuilds next time
+    }
+    return true;
+}
+
+int CaptureIndex::buildProgress() const
+{
+    int total = m_blocksTotal.load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+    return int(qint64(m_blocksDone.load(std::memory_order_relaxed)) * 100 / total);
+}
+
+// "(1690000000.123456) can0 18FEF100#0102030405060708 R"
+bool CaptureIndex::parseLine(const char *p, const char *end, qint64 *tsUs, uint32_t *key)
+{
+    if (p >= end || *p != '(') return false;
+    ++p;
+    qint64 sec = 0;
+    while (p < end && *p >= '0' && *p <= '9') sec = sec * 10 + (*p++ - '0');
+    if (p >= end || *p != '.') return false;
+    ++p;
+    qint64 frac = 0;
+    int digits = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (digits < 6) { frac = frac * 10 + (*p - '0'); digits++; }
+        ++p;
+    }
+    while (digits++ < 6) frac *= 10;
+    if (p >= end || *p != ')') return false;
+    ++p;
+
+    // skip " ifname "
+    while (p < end && *p == ' ') ++p;
+    while (p < end && *p != ' ') ++p;
+    while (p < end && *p == ' ') ++p;
+
+    uint32_t id = 0;
+    int idDigits = 0;
+    int v;
+    while (p < end && (v = hexValue(*p)) >= 0) { id = (id << 4) | uint32_t(v); ++p; ++idDigits; }
+    if (p >= end || *p != '#' || idDigits == 0) return false;
+
+    *tsUs = sec * 1000000 + frac;
+    *key = keyForId(id, idDigits);
+    return true;
+}
+
+uint32_t CaptureIndex::keyForId(uint32_t id, int digits)
+{
+    if (digits <= 3) return id;
+    // error frames are written with CAN_ERR_FLAG in the 8-digit id
+    if (id & CAN_ERR_FLAG) return (id & CAN_ERR_MASK) | CAN_ERR_FLAG;
+    return (id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+}
+
+quint64 CaptureIndex::alignedStart(quint64 pos) const
+{
+    if (pos == 0) return 0;
+    if (pos >= m_size) return m_size;
+    const char *nl = static_cast<const char *>(std::memchr(m_data + pos - 1, '\n', m_size - (pos - 1)));
+    return nl ? quint64(nl - m_data) + 1 : m_size;
+}
+
+bool CaptureIndex::build()
+{
+    // block boundaries at line starts; drop blocks swallowed by a long line
+    QVector<quint64> starts;
+    for (quint64 pos = 0; pos < m_size; pos += kBlockSize) {
+        quint64 s = alignedStart(pos);
+        if (s < m_size && (starts.isEmpty() || s > starts.last())) starts.append(s);
+    }
+    int nblocks = starts.size();
+    starts.append(m_size);
+    m_blocks.resize(nblocks);
+    m_blocksDone.store(0);
+    m_blocksTotal.store(nblocks);
+
+    struct Part {
+        int first = 0;
+        int last = 0;   // exclusive
+        QHash<uint32_t, QVector<Posting>> postings;
+    };
+    int nthreads = qBound(1, QThread::idealThreadCount(), qMax(1, nblocks));
+    QVector<Part> parts(nthreads);
+    Block *blocks = m_blocks.data();
+    const quint64 *bounds = starts.constData();
+    QVector<QThread *> threads;
+    for (int t = 0; t < nthreads; ++t) {
+        Part &part = parts[t];
+        part.first = int(qint64(nblocks) * t / nthreads);
+        part.last = int(qint64(nblocks) * (t + 1) / nthreads);
+        threads.append(QThread::create([this, &part, blocks, bounds]() {
+            QHash<uint32_t, quint32> counts;
+            for (int b = part.first; b < part.last; ++b) {
+                if (m_abort.load(std::memory_order_relaxed)) return;
+                Block &blk = blocks[b];
+                blk.offset = bounds[b];
+                blk.firstLine = 0;
+                blk.firstTsUs = 0;
+                blk.lines = 0;
+                blk.pad = 0;
+                counts.clear();
+                const char *p = m_data + bounds[b];
+                const char *end = m_data + bounds[b + 1];
+                while (p < end) {
+                    const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+                    const char *lineEnd = nl ? nl : end;
+                    qint64 ts;
+                    uint32_t key;
+                    if (parseLine(p, lineEnd, &ts, &key)) {
+                        if (blk.lines == 0) blk.firstTsUs = ts;
+                        blk.lines++;
+                        counts[key]++;
+                    }
+                    p = lineEnd + 1;
+                }
+                for (auto it = counts.constBegin(); it != counts.constEnd(); ++it)
+                    part.postings[it.key()].append(Posting{ quint32(b), it.value() });
+                m_blocksDone.fetch_add(1, std::memory_order_relaxed);
+            }
+        }));
+    }
+    for (QThread *th : threads) th->start();
+    for (QThread *th : threads) { th->wait(); delete th; }
+    if (m_abort.load()) return false;
+
+    // threads own consecutive block ranges, so appending in thread order keeps postings sorted
+    m_totalLines = 0;
+    for (int b = 0; b < nblocks; ++b) {
+        Block &blk = m_blocks[b];
+        blk.firstLine = quint64(m_totalLines);
+        if (blk.lines == 0 && b > 0) blk.firstTsUs = m_blocks[b - 1].firstTsUs;
+        m_totalLines += blk.lines;
+    }
+    for (const Part &part : parts) {
+        for (auto it = part.postings.constBegin(); it != part.postings.constEnd(); ++it)
+            m_postings[it.key()] += it.value();
+    }
+    return true;
+}
+
+bool CaptureIndex::loadSidecar(const QString &path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    QByteArray buf = f.readAll();
+    const char *p = buf.constData();
+    const char *end = p + buf.size();
+
+    auto take = [&p, end](void *dst, size_t n) {
+        if (size_t(end - p) < n) return false;
+        std::memcpy(dst, p, n);
+        p += n;
+        return true;
+    };
+
+    char magic[8];
+    quint64 size;
+    qint64 mtime;
+    quint32 blockSize, nblocks;
+    if (!take(magic, 8) || std::memcmp(magic, kMagic, 8) != 0) return false;
+    if (!take(&size, 8) || !take(&mtime, 8) || !take(&blockSize, 4) || !take(&nblocks, 4)) return false;
+    if (size != m_size || mtime != m_mtimeMs || blockSize != kBlockSize) return false;
+
+    if (size_t(end - p) < sizeof(Block) * nblocks) return false;
+    QVector<Block> blocks(static_cast<int>(nblocks));
+    if (!take(blocks.data(), sizeof(Block) * nblocks)) return false;
+
+    quint32 nkeys;
+    if (!take(&nkeys, 4)) return false;
+    QHash<uint32_t, QVector<Posting>> postings;
+    postings.reserve(int(nkeys));
+    for (quint32 i = 0; i < nkeys; ++i) {
+        quint32 key, n;
+        if (!take(&key, 4) || !take(&n, 4)) return false;
+        if (size_t(end - p) < sizeof(Posting) * n) return false;
+        QVector<Posting> &list = postings[key];
+        list.resize(int(n));
+        if (!take(list.data(), sizeof(Posting) * n)) return false;
+    }
+
+    // size and mtime survive cp -p / rsync -t, so a matching header does not
+    // prove the sidecar belongs to this log: check everything row() and
+    // blockLines() index with before trusting it
+    if (blocks.isEmpty() || blocks[0].offset != 0 || blocks[0].firstLine != 0) return false;
+    for (int b = 0; b < blocks.size(); ++b) {
+        const Block &blk = blocks[b];
+        if (blk.offset >= m_size || (blk.offset > 0 && m_data[blk.offset - 1] != '\n')) return false;
+        if (b > 0 && (blk.offset <= blocks[b - 1].offset
+                      || blk.firstLine != blocks[b - 1].firstLine + blocks[b - 1].lines))
+            return false;
+    }
+    for (auto it = postings.constBegin(); it != postings.constEnd(); ++it) {
+        const QVector<Posting> &list = it.value();
+        for (int i = 0; i < list.size(); ++i) {
+            if (list[i].block >= nblocks || list[i].count == 0
+                    || list[i].count > blocks[int(list[i].block)].lines)
+                return false;
+            if (i > 0 && list[i].block <= list[i - 1].block) return false;
+        }
+    }
+
+    m_blocks = blocks;
+    m_postings = postings;
+    m_totalLines = 0;
+    if (!m_blocks.isEmpty()) m_totalLines = qint64(m_blocks.last().firstLine + m_blocks.last().lines);
+    return true;
+}
+
+void CaptureIndex::saveSidecar(const QString &path) const
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot write capture index" << path << f.errorString();
+        return;
+    }
+    quint64 size = m_size;
+    qint64 mtime = m_mtimeMs;
+    quint32 blockSize = kBlockSize;
+    quint32 nblocks = quint32(m_blocks.size());
+    quint32 nkeys = quint32(m_postings.size());
+    f.write(kMagic, 8);
+    f.write(reinterpret_cast<const char *>(&size), 8);
+    f.write(reinterpret_cast<const char *>(&mtime), 8);
+    f.write(reinterpret_cast<const char *>(&blockSize), 4);
+    f.write(reinterpret_cast<const char *>(&nblocks), 4);
+    f.write(reinterpret_cast<const char *>(m_blocks.constData()), sizeof(Block) * nblocks);
+    f.write(reinterpret_cast<const char *>(&nkeys), 4);
+    for (auto it = m_postings.constBegin(); it != m_postings.constEnd(); ++it) {
+        quint32 key = it.key();
+        quint32 n = quint32(it.value().size());
+        f.write(reinterpret_cast<const char *>(&key), 4);
+        f.write(reinterpret_cast<const char *>(&n), 4);
+        f.write(reinterpret_cast<const char *>(it.value().constData()), sizeof(Posting) * n);
+    }
+}
+
+// ------------------------- row addressing -------------------------
+
+void CaptureIndex::setFilter(uint32_t key)
+{
+    m_filtered = true;
+    m_filterKey = key;
+    m_filterPostings = m_postings.value(key);
+    m_filterPrefix.resize(m_filterPostings.size() + 1);
+    m_filterPrefix[0] = 0;
+    for (int i = 0; i < m_filterPostings.size(); ++i)
+        m_filterPrefix[i + 1] = m_filterPrefix[i] + m_filterPostings[i].count;
+    m_lineCache.clear();
+}
+
+void CaptureIndex::clearFilter()
+{
+    m_filtered = false;
+    m_filterPostings.clear();
+    m_filterPrefix.clear();
+    m_lineCache.clear();
+}
+
+qint64 CaptureIndex::rowCount() const
+{
+    if (m_filtered) return m_filterPrefix.isEmpty() ? 0 : m_filterPrefix.last();
+    return m_totalLines;
+}
+
+const QVector<quint32> *CaptureIndex::blockLines(int block)
+{
+    if (QVector<quint32> *cached = m_lineCache.object(block)) return cached;
+
+    const Block &blk = m_blocks[block];
+    quint64 endOff = block + 1 < m_blocks.size() ? m_blocks[block + 1].offset : m_size;
+    const char *base = m_data + blk.offset;
+    const char *p = base;
+    const char *end = m_data + endOff;
+
+    QVector<quint32> *lines = new QVector<quint32>();
+    lines->reserve(m_filtered ? 64 : int(blk.lines));
+    while (p < end) {
+        const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        const char *lineEnd = nl ? nl : end;
+        qint64 ts;
+        uint32_t key;
+        if (parseLine(p, lineEnd, &ts, &key) && (!m_filtered || key == m_filterKey))
+            lines->append(quint32(p - base));
+        p = lineEnd + 1;
+    }
+    m_lineCache.insert(block, lines, lines->size() * int(sizeof(quint32)) + 1);
+    return m_lineCache.object(block);
+}
+
+CaptureIndex::Line CaptureIndex::row(qint64 row)
+{
+    Line line;
+    if (!m_data || row < 0 || row >= rowCount()) return line;
+
+    int block;
+    qint64 idx;
+    if (m_filtered) {
+        int i = int(std::upper_bound(m_filterPrefix.constBegin(), m_filterPrefix.constEnd(), row)
+                    - m_filterPrefix.constBegin()) - 1;
+        block = int(m_filterPostings[i].block);
+        idx = row - m_filterPrefix[i];
+    } else {
+        auto it = std::upper_bound(m_blocks.constBegin(), m_blocks.constEnd(), quint64(row),
+                                   [](quint64 r, const Block &b) { return r < b.firstLine; });
+        block = int(it - m_blocks.constBegin()) - 1;
+        idx = row - qint64(m_blocks[block].firstLine);
+    }
+
+    const QVector<quint32> *lines = blockLines(block);
+    if (!lines || idx >= lines->size()) return line;
+    line.begin = m_data + m_blocks[block].offset + (*lines)[int(idx)];
+    const char *nl = static_cast<const char *>(std::memchr(line.begin, '\n', m_data + m_size - line.begin));
+    line.len = int((nl ? nl : m_data + m_size) - line.begin);
+    return line;
+}
+
+qint64 CaptureIndex::rowForTime(qint64 tsUs)
+{
+    if (!m_data || m_blocks.isEmpty()) return 0;
+
+    auto byTime = [this](qint64 t, int block) { return t < m_blocks[block].firstTsUs; };
+    int block;
+    qint64 base;
+    qint64 next;
+    if (m_filtered) {
+        if (m_filterPostings.isEmpty()) return 0;
+        int lo = 0, hi = m_filterPostings.size();
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (byTime(tsUs, int(m_filterPostings[mid].block))) hi = mid; else lo = mid + 1;
+        }
+        int i = qMax(0, lo - 1);
+        block = int(m_filterPostings[i].block);
+        base = m_filterPrefix[i];
+        next = m_filterPrefix[i + 1];
+    } else {
+        int lo = 0, hi = m_blocks.size();
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (byTime(tsUs, mid)) hi = mid; else lo = mid + 1;
+        }
+        block = qMax(0, lo - 1);
+        base = qint64(m_blocks[block].firstLine);
+        next = base + m_blocks[block].lines;
+    }
+
+    const QVector<quint32> *lines = blockLines(block);
+    const char *blockBase = m_data + m_blocks[block].offset;
+    const char *fileEnd = m_data + m_size;
+    for (int i = 0; lines && i < lines->size(); ++i) {
+        const char *p = blockBase + (*lines)[i];
+        const char *nl = static_cast<const char *>(std::memchr(p, '\n', fileEnd - p));
+        qint64 ts;
+        uint32_t key;
+        if (parseLine(p, nl ? nl : fileEnd, &ts, &key) && ts >= tsUs) return base + i;
+    }
+    return qMin(next, rowCount() - 1);
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <QCache>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <atomic>
+
+// Random access into large candump logs (the format CaptureBuffer writes).
+// The log is memory-mapped and split into ~1 MiB blocks aligned to line
+// starts. A sidecar "<log>.idx" stores, per block, its offset, first line
+// number and first timestamp, plus a posting list per CAN ID of
+// (block, matching lines). The sidecar is built in parallel on first open
+// and reused while the log's size and mtime are unchanged and its offsets
+// and posting lists are consistent with the log; otherwise it is rebuilt.
+//
+// Rows are addressed either over the whole log or, with a filter set, over
+// the lines of one ID; only the blocks a lookup lands in are ever scanned.
+//
+// open() may run on a worker thread; buildProgress() and abort() are safe
+// to call from any thread meanwhile. Everything else belongs to one thread
+// at a time.
+class CaptureIndex
+{
+public:
+    struct Line {
+        const char *begin = nullptr;
+        int len = 0;
+    };
+
+    CaptureIndex();
+    ~CaptureIndex();
+
+    bool open(const QString &path, QString *error);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+    bool builtIndex() const { return m_built; }   // false if loaded from sidecar
+    int buildProgress() const;                    // percent of blocks indexed
+    // makes a running open() stop building after the current blocks and fail
+    void abort() { m_abort.store(true); }
+
+    qint64 totalLines() const { return m_totalLines; }
+    int blockCount() const { return m_blocks.size(); }
+    int idCount() const { return m_postings.size(); }
+
+    // key = CAN id, with CAN_EFF_FLAG set for 29-bit ids; error frames are
+    // CAN_ERR_FLAG plus their error class bits
+    void setFilter(uint32_t key);
+    void clearFilter();
+    bool hasFilter() const { return m_filtered; }
+
+    qint64 rowCount() const;
+    Line row(qint64 row);
+    qint64 rowForTime(qint64 tsUs);   // first row at or after tsUs
+
+    static bool parseLine(const char *p, const char *end, qint64 *tsUs, uint32_t *key);
+    // key of a hex id as candump writes it (more than three digits = 29-bit)
+    static uint32_t keyForId(uint32_t id, int digits);
+
+private:
+    enum { kBlockSize = 1 << 20 };
+
+    struct Block {
+        quint64 offset;
+        quint64 firstLine;
+        qint64 firstTsUs;
+        quint32 lines;
+        quint32 pad;
+    };
+    struct Posting {
+        quint32 block;
+        quint32 count;
+    };
+
+    bool loadSidecar(const QString &path);
+    void saveSidecar(const QString &path) const;
+    bool build();   // false if aborted
+    quint64 alignedStart(quint64 pos) const;
+    // line start offsets of a block (all lines, or only the filtered key's)
+    const QVector<quint32> *blockLines(int block);
+
+    QFile m_file;
+    const char *m_data = nullptr;
+    quint64 m_size = 0;
+    qint64 m_mtimeMs = 0;
+    bool m_built = false;
+    std::atomic<int> m_blocksTotal{0};
+    std::atomic<int> m_blocksDone{0};
+    std::atomic<bool> m_abort{false};
+
+    QVector<Block> m_blocks;
+    qint64 m_totalLines = 0;
+    QHash<uint32_t, QVector<Posting>> m_postings;
+
+    bool m_filtered = false;
+    uint32_t m_filterKey = 0;
+    QVector<Posting> m_filterPostings;
+    QVector<qint64> m_filterPrefix;   // rows before each posting
+
+    QCache<int, QVector<quint32>> m_lineCache;
+};
@@ -0,0 +1,380 @@
+#include "loadgenerator.h"
+
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <errno.h>
+#include <QStringList>
+#include <QThread>
+
+enum { kMaxBatch = 64 };
+// sequence payload: marker, seq (24 bit LE), TX time in us (32 bit LE)
+static const uint8_t kSeqMarker = 0xA5;
+static const uint32_t kSeqMask = 0xFFFFFF;
+// retry delay while the TX queue is full (~one classic frame at 500 kbit/s)
+static const long kTxBackoffNs = 200000;
+
+static qint64 monoNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// nominal frame length incl. interframe space, without stuff bits
+static double bitsPerFrame(double dlc, bool extended)
+{
+    return (extended ? 67.0 : 47.0) + 8.0 * dlc;
+}
+
+LoadGenerator::LoadGenerator(QObject *parent)
+    : QObject(parent)
+{
+}
+
+LoadGenerator::~LoadGenerator()
+{
+    stop();
+}
+
+bool LoadGenerator::parseConfig(const QString &id, const QString &dlc, const QString &data,
+                                const QString &rate, int bitrate, int batch,
+                                Config *out, QString *error)
+{
+    Config cfg;
+    auto fail = [error](const QString &msg) { if (error) *error = msg; return false; };
+
+    // ---- id
+    QString s = id.trimmed().toLower();
+    if (s.isEmpty()) s = "r";
+    bool ok = false;
+    if (s[0] == 'r' || s[0] == 'i') {
+        cfg.idMode = s[0] == 'r' ? IdRandom : IdSequential;
+        cfg.idMin = 0;
+        cfg.idMax = CAN_SFF_MASK;
+        cfg.extended = false;
+        if (s.size() > 1) {
+            QStringList range = s.mid(1).remove(':').split('-');
+            if (range.size() != 2) return fail(QString("invalid id range: %1").arg(id));
+            cfg.idMin = range[0].toUInt(&ok, 16);
+            if (!ok) return fail(QString("invalid id range: %1").arg(id));
+            cfg.idMax = range[1].toUInt(&ok, 16);
+            if (!ok || cfg.idMax < cfg.idMin) return fail(QString("invalid id range: %1").arg(id));
+            cfg.extended = cfg.idMax > CAN_SFF_MASK || range[1].size() > 3;
+        }
+    } else if (s.contains(',')) {
+        cfg.idMode = IdList;
+        cfg.extended = false;
+        for (const QString &part : s.split(',')) {
+            if (part.trimmed().isEmpty()) continue;
+            uint32_t v = part.trimmed().toUInt(&ok, 16);
+            if (!ok) return fail(QString("invalid id in list: %1").arg(part));
+            cfg.idList.append(v);
+            if (v > CAN_SFF_MASK || part.trimmed().size() > 3) cfg.extended = true;
+        }
+        if (cfg.idList.isEmpty()) return fail("empty id list");
+    } else {
+        cfg.idMode = IdFixed;
+        if (s.startsWith("0x")) s = s.mid(2);
+        cfg.idMin = cfg.idMax = s.toUInt(&ok, 16);
+        if (!ok) return fail(QString("invalid id: %1").arg(id));
+        cfg.extended = cfg.idMin > CAN_SFF_MASK || s.size() > 3;
+    }
+    if (cfg.extended) {
+        cfg.idMin &= CAN_EFF_MASK;
+        cfg.idMax &= CAN_EFF_MASK;
+    }
+
+    // ---- payload
+    s = data.trimmed().toLower();
+    if (s.isEmpty() || s == "r") cfg.payloadMode = PayloadRandom;
+    else if (s == "i") cfg.payloadMode = PayloadIncrement;
+    else if (s == "s") cfg.payloadMode = PayloadSequence;
+    else {
+        cfg.payloadMode = PayloadFixed;
+        cfg.data = QByteArray::fromHex(s.remove(' ').toLatin1());
+        if (cfg.data.isEmpty() || cfg.data.size() > 8) return fail(QString("invalid data: %1").arg(data));
+    }
+
+    // ---- dlc
+    s = dlc.trimmed().toLower();
+    if (cfg.payloadMode == PayloadSequence) {
+        cfg.dlc = 8;   // marker + sequence + timestamp need the full frame
+    } else if (s == "r") {
+        cfg.dlc = -1;
+    } else if (s.isEmpty()) {
+        cfg.dlc = cfg.payloadMode == PayloadFixed ? cfg.data.size() : 8;
+    } else {
+        cfg.dlc = s.toInt(&ok);
+        if (!ok || cfg.dlc < 0 || cfg.dlc > 8) return fail(QString("invalid dlc: %1").arg(dlc));
+    }
+
+    // ---- rate
+    s = rate.trimmed().toLower();
+    if (s == "max" || s == "100%") {
+        cfg.rateFps = 0.0;
+    } else if (s.endsWith('%')) {
+        double pct = s.left(s.size() - 1).toDouble(&ok);
+        if (!ok || pct <= 0.0 || pct > 100.0) return fail(QString("invalid bus load: %1").arg(rate));
+        double avgDlc = cfg.dlc < 0 ? 4.0 : cfg.dlc;
+        cfg.rateFps = pct / 100.0 * qMax(bitrate, 1) / bitsPerFrame(avgDlc, cfg.extended);
+    } else {
+        cfg.rateFps = s.isEmpty() ? 100.0 : s.toDouble(&ok);
+        if (!s.isEmpty() && (!ok || cfg.rateFps <= 0.0)) return fail(QString("invalid rate: %1").arg(rate));
+    }
+
+    cfg.batch = qBound(1, batch, int(kMaxBatch));
+    *out = cfg;
+    return true;
+}
+
+bool LoadGenerator::start(const QString &ifname, const Config &cfg, const QString &checkIfname, QString *error)
+{
+    stop();
+
+    // TX only: sndbuf bounds how far the generator runs ahead of the bus,
+    // and the socket must not queue up received traffic or error frames
+    m_txFd = CanManager::openRawSocket(ifname.toStdString(), 0, m_sndbuf, error);
+    if (m_txFd < 0) return false;
+    can_err_mask_t noErrors = 0;
+    setsockopt(m_txFd, SOL_CAN_RAW, CAN_RAW_FILTER, nullptr, 0);
+    setsockopt(m_txFd, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &noErrors, sizeof(noErrors));
+
+    if (!checkIfname.isEmpty() && cfg.payloadMode == PayloadSequence) {
+        // SO_RXQ_OVFL is on: this socket's own queue drops are counted apart
+        // from the sequence gaps they also cause
+        m_rxFd = CanManager::openRawSocket(checkIfname.toStdString(), m_rcvbuf, 0, error);
+        if (m_rxFd < 0) {
+            ::close(m_txFd);
+            m_txFd = -1;
+            return false;
+        }
+    }
+
+    m_stop.store(false);
+    m_sent.store(0);
+    m_txBusy.store(0);
+    m_received.store(0);
+    m_lost.store(0);
+    m_reordered.store(0);
+    m_rxStats.reset();
+    m_latency.reset();
+
+    if (m_rxFd >= 0) {
+        int fd = m_rxFd;
+        m_rxThread = QThread::create([this, fd]() { checkLoop(fd); });
+        m_rxThread->start();
+    }
+    int fd = m_txFd;
+    m_txThread = QThread::create([this, fd, cfg]() { txLoop(fd, cfg); });
+    m_txThread->start(QThread::HighPriority);
+    return true;
+}
+
+void LoadGenerator::stop()
+{
+    m_stop.store(true);
+    if (m_txThread) {
+        m_txThread->wait();
+        delete m_txThread;
+        m_txThread = nullptr;
+    }
+    if (m_rxThread) {
+        m_rxThread->wait();
+        delete m_rxThread;
+        m_rxThread = nullptr;
+    }
+    if (m_txFd >= 0) { ::close(m_txFd); m_txFd = -1; }
+    if (m_rxFd >= 0) { ::close(m_rxFd); m_rxFd = -1; }
+}
+
+LoadGenerator::Stats LoadGenerator::stats() const
+{
+    Stats st;
+    st.sent = m_sent.load(std::memory_order_relaxed);
+    st.txBusy = m_txBusy.load(std::memory_order_relaxed);
+    st.received = m_received.load(std::memory_order_relaxed);
+    st.lost = m_lost.load(std::memory_order_relaxed);
+    st.reordered = m_reordered.load(std::memory_order_relaxed);
+    st.rxDropped = m_rxStats.snapshot().dropped;
+    st.latP50Us = m_latency.percentileUs(0.50);
+    st.latP99Us = m_latency.percentileUs(0.99);
+    st.latMaxUs = m_latency.maxNs.load(std::memory_order_relaxed) / 1000;
+    return st;
+}
+
+void LoadGenerator::txLoop(int fd, Config cfg)
+{
+    struct can_frame frames[kMaxBatch];
+    struct mmsghdr msgs[kMaxBatch];
+    struct iovec iov[kMaxBatch];
+    std::memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < kMaxBatch; ++i) {
+        iov[i].iov_base = &frames[i];
+        iov[i].iov_len = sizeof(struct can_frame);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    uint64_t rng = uint64_t(monoNs()) | 1;
+    auto next = [&rng]() {   // xorshift64
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    };
+    uint32_t nextId = cfg.idMin;
+    int listPos = 0;
+    uint64_t counter = 0;
+    uint32_t seq = 0;
+    const uint32_t idSpan = cfg.idMax - cfg.idMin + 1;
+
+    const double nsPerFrame = cfg.rateFps > 0.0 ? 1e9 / cfg.rateFps : 0.0;
+    qint64 startNs = monoNs();
+    quint64 produced = 0;
+
+    while (!m_stop.load(std::memory_order_relaxed)) {
+        int n = cfg.batch;
+        if (nsPerFrame > 0.0) {
+            qint64 now = monoNs();
+            qint64 dueNs = startNs + qint64(produced * nsPerFrame);
+            if (now < dueNs) {
+                qint64 wait = dueNs - now;
+                if (wait > 200000) {
+                    // sleep most of the gap, spin the rest for accurate pacing
+                    struct timespec until;
+                    qint64 wake = dueNs - 50000;
+                    until.tv_sec = wake / 1000000000;
+                    until.tv_nsec = wake % 1000000000;
+                    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr);
+                }
+                continue;
+            }
+            quint64 due = quint64((now - startNs) / nsPerFrame) + 1;
+            // more than a second behind (e.g. bus-off): don't burst to catch up
+            if (due - produced > quint64(cfg.rateFps) + quint64(cfg.batch)) {
+                startNs = now - qint64(produced * nsPerFrame);
+                due = produced + 1;
+            }
+            n = int(qMin<quint64>(due - produced, quint64(cfg.batch)));
+        }
+
+        for (int i = 0; i < n; ++i) {
+            struct can_frame &f = frames[i];
+            std::memset(&f, 0, sizeof(f));
+            uint32_t id;
+            switch (cfg.idMode) {
+            case IdFixed: id = cfg.idMin; break;
+            case IdRandom: id = cfg.idMin + uint32_t(next() % idSpan); break;
+            case IdSequential:
+                id = nextId;
+                nextId = nextId >= cfg.idMax ? cfg.idMin : nextId + 1;
+                break;
+            case IdList:
+            default:
+                id = cfg.idList[listPos];
+                listPos = (listPos + 1) % cfg.idList.size();
+                break;
+            }
+            f.can_id = cfg.extended ? ((id & CAN_EFF_MASK) | CAN_EFF_FLAG) : (id & CAN_SFF_MASK);
+            f.can_dlc = uint8_t(cfg.dlc < 0 ? next() % 9 : cfg.dlc);
+
+            switch (cfg.payloadMode) {
+            case PayloadFixed:
+                std::memcpy(f.data, cfg.data.constData(), qMin(int(f.can_dlc), cfg.data.size()));
+                break;
+            case PayloadRandom: {
+                uint64_t r = next();
+                std::memcpy(f.data, &r, 8);
+                break;
+            }
+            case PayloadIncrement:
+                std::memcpy(f.data, &counter, 8);
+                counter++;
+                break;
+            case PayloadSequence: {
+                uint32_t txUs = uint32_t(monoNs() / 1000);
+                f.data[0] = kSeqMarker;
+                f.data[1] = uint8_t(seq);
+                f.data[2] = uint8_t(seq >> 8);
+                f.data[3] = uint8_t(seq >> 16);
+                std::memcpy(f.data + 4, &txUs, 4);
+                seq = (seq + 1) & kSeqMask;
+                break;
+            }
+            }
+        }
+
+        int done = 0;
+        while (done < n && !m_stop.load(std::memory_order_relaxed)) {
+            int k = sendmmsg(fd, msgs + done, n - done, MSG_DONTWAIT);
+            if (k > 0) {
+                done += k;
+                continue;
+            }
+            if (errno == ENOBUFS || errno == EAGAIN) {
+                // TX queue full: the bus is saturated. POLLOUT is no help here,
+                // the socket's send buffer is nearly empty while the qdisc /
+                // driver queue rejects frames, so sleep for about a frame time
+                m_txBusy.fetch_add(1, std::memory_order_relaxed);
+                struct timespec backoff = { 0, kTxBackoffNs };
+                clock_nanosleep(CLOCK_MONOTONIC, 0, &backoff, nullptr);
+                continue;
+            }
+            // interface went away or was reconfigured
+            emit generatorFailed(QString("sendmmsg failed: %1").arg(strerror(errno)));
+            m_stop.store(true);
+            break;
+        }
+        produced += done;
+        m_sent.fetch_add(done, std::memory_order_relaxed);
+    }
+}
+
+void LoadGenerator::checkLoop(int fd)
+{
+    CanRxBatch batch;
+    bool first = true;
+    uint32_t expected = 0;
+    while (!m_stop.load(std::memory_order_relaxed)) {
+        // queue drops of this socket are counted into m_rxStats
+        int n = batch.read(fd, &m_rxStats, kMaxBatch);
+        if (n <= 0) {
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            poll(&pfd, 1, 100);
+            continue;
+        }
+        uint32_t nowUs = uint32_t(monoNs() / 1000);
+        for (int i = 0; i < n; ++i) {
+            const struct can_frame &f = batch.frames[i];
+            if ((f.can_id & CAN_ERR_FLAG) || f.can_dlc != 8 || f.data[0] != kSeqMarker)
+                continue;
+            uint32_t s = uint32_t(f.data[1]) | (uint32_t(f.data[2]) << 8) | (uint32_t(f.data[3]) << 16);
+            uint32_t txUs;
+            std::memcpy(&txUs, f.data + 4, 4);
+            m_latency.record(qint64(uint32_t(nowUs - txUs)) * 1000);
+            m_received.fetch_add(1, std::memory_order_relaxed);
+
+            if (first) {
+                first = false;
+                expected = (s + 1) & kSeqMask;
+                continue;
+            }
+            uint32_t ahead = (s - expected) & kSeqMask;
+            if (ahead == 0) {
+                expected = (s + 1) & kSeqMask;
+            } else if (ahead < kSeqMask / 2) {
+                m_lost.fetch_add(ahead, std::memory_order_relaxed);
+                expected = (s + 1) & kSeqMask;
+            } else {
+                // older than expected: arrived late, so one counted loss was a reorder
+                m_reordered.fetch_add(1, std::memory_order_relaxed);
+                if (m_lost.load(std::memory_order_relaxed) > 0) m_lost.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include "canmanager.h"
+
+class QThread;
+
+// cangen-style traffic generator. Frames are produced on a dedicated TX
+// thread with its own raw socket and written in sendmmsg batches, paced to
+// a frame rate or a share of the bus bitrate (or unpaced for saturation).
+//
+// In sequence payload mode every frame carries a marker, a 24-bit
+// sequence number and a 32-bit microsecond TX timestamp; an optional
+// checker thread reading a second socket (same or another interface)
+// counts loss, reordering and TX->RX latency from them.
+class LoadGenerator : public QObject
+{
+    Q_OBJECT
+public:
+    enum IdMode { IdFixed, IdRandom, IdSequential, IdList };
+    enum PayloadMode { PayloadFixed, PayloadRandom, PayloadIncrement, PayloadSequence };
+
+    struct Config {
+        IdMode idMode = IdFixed;
+        uint32_t idMin = 0;         // fixed id, or range for random/sequential
+        uint32_t idMax = 0;
+        QVector<uint32_t> idList;
+        bool extended = true;
+        int dlc = 8;                // -1 = random 0..8
+        PayloadMode payloadMode = PayloadFixed;
+        QByteArray data;            // fixed payload
+        double rateFps = 100.0;     // 0 = as fast as the TX queue accepts
+        int batch = 16;             // frames per sendmmsg
+    };
+
+    struct Stats {
+        quint64 sent = 0;
+        quint64 txBusy = 0;         // ENOBUFS / EAGAIN retries
+        quint64 received = 0;
+        quint64 lost = 0;
+        quint64 reordered = 0;
+        quint64 rxDropped = 0;      // checker socket queue overflows (SO_RXQ_OVFL); also show up in lost
+        quint64 latP50Us = 0;
+        quint64 latP99Us = 0;
+        quint64 latMaxUs = 0;
+    };
+
+    explicit LoadGenerator(QObject *parent = nullptr);
+    ~LoadGenerator();
+
+    // cangen-like specs, e.g. id "r:100-1FF" / "i" / "18FF0000" / "100,200",
+    // dlc "8" / "r", data "r" / "i" / "s" / "DEADBEEF", rate "500" / "60%" / "max"
+    static bool parseConfig(const QString &id, const QString &dlc, const QString &data,
+                            const QString &rate, int bitrate, int batch,
+                            Config *out, QString *error);
+
+    // socket buffer sizes for the next start(): sndbuf for the TX socket,
+    // rcvbuf for the checker (0 = kernel default)
+    void setSocketBuffers(int rcvbuf, int sndbuf) { m_rcvbuf = rcvbuf; m_sndbuf = sndbuf; }
+
+    // checkIfname empty = no checker; only meaningful with PayloadSequence
+    bool start(const QString &ifname, const Config &cfg, const QString &checkIfname, QString *error);
+    void stop();
+    bool isRunning() const { return m_txThread != nullptr; }
+
+    Stats stats() const;
+
+signals:
+    // emitted from the TX thread when it gives up; the generator must still be stop()ped
+    void generatorFailed(const QString &error);
+
+private:
+    void txLoop(int fd, Config cfg);
+    void checkLoop(int fd);
+
+    int m_txFd = -1;
+    int m_rxFd = -1;
+    int m_rcvbuf = 0;
+    int m_sndbuf = 0;
+    QThread *m_txThread = nullptr;
+    QThread *m_rxThread = nullptr;
+    std::atomic<bool> m_stop{false};
+
+    std::atomic<quint64> m_sent{0};
+    std::atomic<quint64> m_txBusy{0};
+    std::atomic<quint64> m_received{0};
+    std::atomic<quint64> m_lost{0};
+    std::atomic<quint64> m_reordered{0};
+    CanRxStats m_rxStats;            // checker socket
+    RxLatencyHistogram m_latency;
+};
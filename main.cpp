@@ -1,8 +1,36 @@
 #include "mainwindow.h"
+#include "rxreport.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <cstring>
+
+// headless: qt_canctl_2.2 --report [--iface can0] [--interval 1000] [--duration 0] [--rcvbuf N] [--sndbuf N]
+static int runReport(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCommandLineParser p;
+    p.addHelpOption();
+    p.addOption(QCommandLineOption("report", "Print RX frames vs. drops per interval and exit."));
+    p.addOption(QCommandLineOption("iface", "CAN interface.", "name", "can0"));
+    p.addOption(QCommandLineOption("interval", "Report interval in ms.", "ms", "1000"));
+    p.addOption(QCommandLineOption("duration", "Stop after this many seconds (0 = run until killed).", "s", "0"));
+    p.addOption(QCommandLineOption("rcvbuf", "SO_RCVBUF in bytes (0 = default).", "bytes", "0"));
+    p.addOption(QCommandLineOption("sndbuf", "SO_SNDBUF in bytes (0 = default).", "bytes", "0"));
+    p.process(a);
+
+    RxReport report;
+    QObject::connect(&report, &RxReport::finished, &a, &QCoreApplication::quit);
+    if (!report.start(p.value("iface"), p.value("interval").toInt(), p.value("duration").toInt(),
+                      p.value("rcvbuf").toInt(), p.value("sndbuf").toInt()))
+        return 1;
+    return a.exec();
+}
 
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; ++i)
+        if (std::strcmp(argv[i], "--report") == 0) return runReport(argc, argv);
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
@@ -1,26 +1,51 @@
 #include <QMessageBox>
+#include <QApplication>
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "settingsdialog.h"
+#include "canmanager.h"
+#include "cangateway.h"
+#include "capturebuffer.h"
+#include "capturebrowser.h"
+#include "monitormodel.h"
+#include "loadgenerator.h"
+#include "signalplot.h"
 
 #include <QProcess>
 #include <QDebug>
 #include <QFile>
 #include <QJsonDocument>
+#include <QJsonArray>
 #include <QStandardPaths>
 #include <QDir>
 #include <QDateTime>
 #include <QTableWidgetItem>
+#include <QFileDialog>
+#include <QHeaderView>
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <linux/can.h>
-#include <linux/can/raw.h>
-#include <net/if.h>
-#include <sys/ioctl.h>
+#include <linux/can/error.h>
 #include <unistd.h>
 #include <cstring>
 #include <errno.h>
+#include <time.h>
+
+// frames drained per readable notification
+static const int kRxBatch = 32;
+
+static qint64 realtimeNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static qint64 realtimeUs()
+{
+    return realtimeNs() / 1000;
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
@@ -42,22 +67,74 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->btnRight, &QPushButton::clicked, this, &MainWindow::onRightClicked);
     connect(ui->btnStop, &QPushButton::clicked, this, &MainWindow::onStopClicked);
     connect(ui->btnClearLog, &QPushButton::clicked, this, &MainWindow::onClearLogClicked);
+    connect(ui->chkCapture, &QCheckBox::toggled, this, &MainWindow::onCaptureToggled);
+    connect(ui->btnTrigger, &QPushButton::clicked, this, &MainWindow::onTriggerClicked);
+    connect(ui->btnOpenCapture, &QPushButton::clicked, this, &MainWindow::onOpenCaptureClicked);
+    connect(ui->chkMonitor, &QCheckBox::toggled, this, &MainWindow::onMonitorToggled);
+    connect(ui->btnGenerate, &QPushButton::toggled, this, &MainWindow::onGenerateToggled);
+    connect(ui->chkPlot, &QCheckBox::toggled, this, &MainWindow::onPlotToggled);
 
     // loop timer
     m_loopTimer.setSingleShot(false);
     connect(&m_loopTimer, &QTimer::timeout, this, &MainWindow::onLoopTimeout);
 
+    // gateway
+    m_can = new CanManager(this);
+    m_gateway = new CanGateway(m_can, this);
+    connect(m_gateway, &CanGateway::gatewayError, this, [this](const QString &msg) {
+        logText("SYS", QString("Gateway: %1").arg(msg));
+    });
+
+    // trigger capture
+    m_capture = new CaptureBuffer(this);
+    connect(m_capture, &CaptureBuffer::triggered, this, [this](const QString &reason) {
+        logText("SYS", QString("Capture triggered (%1)").arg(reason));
+    });
+    connect(m_capture, &CaptureBuffer::captureSaved, this, [this](const QString &path, int frames) {
+        logText("SYS", QString("Capture saved: %1 (%2 frames)").arg(path).arg(frames));
+    });
+    connect(m_capture, &CaptureBuffer::captureError, this, [this](const QString &msg) {
+        logText("SYS", QString("Capture: %1").arg(msg));
+    });
+
+    // monitor view
+    m_monitor = new MonitorModel(this);
+    ui->tableMonitor->setModel(m_monitor);
+    ui->tableMonitor->verticalHeader()->setVisible(false);
+    ui->tableMonitor->verticalHeader()->setDefaultSectionSize(20);
+    ui->tableMonitor->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->tableMonitor->hide();
+    m_monitorTimer.setSingleShot(false);
+    connect(&m_monitorTimer, &QTimer::timeout, m_monitor, &MonitorModel::refresh);
+
+    // load generator
+    m_generator = new LoadGenerator(this);
+    connect(m_generator, &LoadGenerator::generatorFailed, this, [this](const QString &msg) {
+        logText("SYS", QString("Generator: %1").arg(msg));
+        ui->btnGenerate->setChecked(false);   // stops and reports via onGenerateToggled()
+    });
+
+    // status bar statistics
+    m_statsTimer.setSingleShot(false);
+    connect(&m_statsTimer, &QTimer::timeout, this, &MainWindow::onStatsTimeout);
+    m_statsTimer.start(1000);
+
     // load settings
     loadSettings();
     applySettingsFromJson();
 
     // initial CAN indicator by checking system state
-    updateCanIndicator(isCanInterfaceUp());
+    bool up = isCanInterfaceUp();
+    updateCanIndicator(up);
+    updateCanManager(up);
 }
 
 MainWindow::~MainWindow()
 {
     saveSettings();
+    m_generator->stop();
+    m_gateway->stop();
+    m_can->close();
     closeCanSocket();
     delete ui;
 }
@@ -112,40 +189,22 @@ bool MainWindow::openCanSocket()
 
     if (m_socket >= 0) return true;
 
-    m_socket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    QString error;
+    int rcv = 0, snd = 0;
+    m_socket = CanManager::openRawSocket(m_canInterface.toStdString(), m_rcvbuf, m_sndbuf, &error, &rcv, &snd);
     if (m_socket < 0) {
-        logText("SYS", QString("socket() failed: %1").arg(strerror(errno)));
-        m_socket = -1;
-        return false;
-    }
-
-    struct ifreq ifr;
-    std::memset(&ifr, 0, sizeof(ifr));
-    QByteArray name = m_canInterface.toLocal8Bit();
-    std::strncpy(ifr.ifr_name, name.constData(), IFNAMSIZ - 1);
-
-    if (ioctl(m_socket, SIOCGIFINDEX, &ifr) < 0) {
-        logText("SYS", QString("ioctl SIOCGIFINDEX failed: %1").arg(strerror(errno)));
-        ::close(m_socket); m_socket = -1;
-        return false;
-    }
-
-    struct sockaddr_can addr;
-    std::memset(&addr, 0, sizeof(addr));
-    addr.can_family = AF_CAN;
-    addr.can_ifindex = ifr.ifr_ifindex;
-
-    if (bind(m_socket, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
-        logText("SYS", QString("bind failed: %1").arg(strerror(errno)));
-        ::close(m_socket); m_socket = -1;
+        logText("SYS", QString("Cannot open socket: %1").arg(error));
         return false;
     }
+    m_rxStats.reset();
+    m_rxLast = CanRxCounters();
+    m_rxLatency.reset();
 
     // start notifier
     m_notifier = new QSocketNotifier(m_socket, QSocketNotifier::Read, this);
     connect(m_notifier, &QSocketNotifier::activated, this, &MainWindow::onCanReadable);
 
-    logText("SYS", QString("Socket opened on %1").arg(m_canInterface));
+    logText("SYS", QString("Socket opened on %1 (rcvbuf %2, sndbuf %3)").arg(m_canInterface).arg(rcv).arg(snd));
     return true;
 }
 
@@ -191,6 +250,7 @@ void MainWindow::sendCanFrame(const QByteArray &data, bool forceOpen)
     if (n != sizeof(frame)) {
         logText("SYS", QString("write failed: %1").arg(strerror(errno)));
     } else {
+        m_capture->push(realtimeUs(), frame, true);
         logFrame("TX", frame);
     }
 }
@@ -217,7 +277,9 @@ void MainWindow::onConnectClicked()
     }
 
     // update indicator after attempting toggle
-    updateCanIndicator(isCanInterfaceUp());
+    bool up = isCanInterfaceUp();
+    updateCanIndicator(up);
+    updateCanManager(up);
 }
 
 void MainWindow::onSettingsClicked()
@@ -247,6 +309,7 @@ void MainWindow::onSettingsClicked()
         m_settingsJson = dlg.toJson();
         saveSettings();
         applySettingsFromJson();
+        updateCanManager(isCanInterfaceUp());
     }
 }
 
@@ -307,6 +370,130 @@ void MainWindow::onStopClicked()
 void MainWindow::onClearLogClicked()
 {
     ui->tableLog->setRowCount(0);
+    m_monitor->clear();
+    ui->plotSignals->clear();
+}
+
+void MainWindow::onMonitorToggled(bool on)
+{
+    ui->tableLog->setVisible(!on);
+    ui->tableMonitor->setVisible(on);
+    if (on) {
+        // RX only reaches the monitor, so make sure the socket is listening
+        openCanSocket();
+        m_monitor->refresh();
+        m_monitorTimer.start(100);
+    } else {
+        m_monitorTimer.stop();
+        ui->tableLog->scrollToBottom();
+    }
+}
+
+void MainWindow::onPlotToggled(bool on)
+{
+    if (on && ui->plotSignals->signalCount() == 0) {
+        logText("SYS", "Plot: no signals configured (plot_signals)");
+    }
+    // like the monitor, the plot is fed from the GUI socket
+    if (on) openCanSocket();
+    ui->plotSignals->setRecording(on);
+}
+
+void MainWindow::onCaptureToggled(bool on)
+{
+    if (!on) {
+        m_capture->disarm();
+        logText("SYS", "Capture disarmed");
+        return;
+    }
+    // the socket is otherwise only opened on the first send
+    if (!openCanSocket()) {
+        ui->chkCapture->setChecked(false);
+        return;
+    }
+    m_capture->arm();
+    logText("SYS", "Capture armed");
+}
+
+void MainWindow::onTriggerClicked()
+{
+    if (!m_capture->isArmed()) {
+        logText("SYS", "Capture not armed");
+        return;
+    }
+    m_capture->triggerManual();
+}
+
+void MainWindow::onOpenCaptureClicked()
+{
+    QString dir = m_settingsJson.value("capture_dir").toString();
+    QString path = QFileDialog::getOpenFileName(this, "Open capture", dir, "candump logs (*.log);;All files (*)");
+    if (path.isEmpty()) return;
+
+    // first open of a large log builds its index on all cores; that runs
+    // off this thread so CAN RX, capture and gateway keep going meanwhile
+    CaptureBrowser *browser = new CaptureBrowser(this);
+    ui->btnOpenCapture->setEnabled(false);
+    m_indexStatus = "Indexing capture...";
+    connect(browser, &CaptureBrowser::indexProgress, this, [this](int percent) {
+        m_indexStatus = QString("Indexing capture %1%").arg(percent);
+    });
+    connect(browser, &CaptureBrowser::logOpened, this, [this, browser]() {
+        ui->btnOpenCapture->setEnabled(true);
+        m_indexStatus.clear();
+        browser->show();
+    });
+    connect(browser, &CaptureBrowser::openFailed, this, [this, browser, path](const QString &error) {
+        ui->btnOpenCapture->setEnabled(true);
+        m_indexStatus.clear();
+        browser->deleteLater();
+        QMessageBox::warning(this, "Open capture", QString("Cannot open %1: %2").arg(path, error));
+    });
+    browser->openLog(path);
+}
+
+void MainWindow::onGenerateToggled(bool on)
+{
+    if (!on) {
+        if (m_generator->isRunning()) {
+            m_generator->stop();
+            LoadGenerator::Stats st = m_generator->stats();
+            logText("SYS", QString("Generator stopped: %1 frames sent").arg(st.sent));
+        }
+        return;
+    }
+
+    if (!isCanInterfaceUp()) {
+        logText("SYS", QString("Interface %1 is DOWN; cannot generate").arg(m_canInterface));
+        ui->btnGenerate->setChecked(false);
+        return;
+    }
+
+    LoadGenerator::Config cfg;
+    QString error;
+    if (!LoadGenerator::parseConfig(m_settingsJson.value("gen_id").toString("r"),
+                                    m_settingsJson.value("gen_dlc").toString(),
+                                    m_settingsJson.value("gen_data").toString("s"),
+                                    m_settingsJson.value("gen_rate").toString("1000"),
+                                    m_settingsJson.value("bitrate").toInt(250000),
+                                    m_settingsJson.value("gen_batch").toInt(16),
+                                    &cfg, &error)) {
+        logText("SYS", QString("Generator: %1").arg(error));
+        ui->btnGenerate->setChecked(false);
+        return;
+    }
+    // sequence payloads are checked on gen_check (default: same interface)
+    QString check = m_settingsJson.value("gen_check").toString(m_canInterface);
+    m_generator->setSocketBuffers(m_rcvbuf, m_sndbuf);
+    if (!m_generator->start(m_canInterface, cfg, check, &error)) {
+        logText("SYS", QString("Generator: %1").arg(error));
+        ui->btnGenerate->setChecked(false);
+        return;
+    }
+    m_genLastSent = 0;
+    logText("SYS", QString("Generator on %1: %2")
+            .arg(m_canInterface)
+            .arg(cfg.rateFps > 0.0 ? QString("%1 frames/s").arg(cfg.rateFps, 0, 'f', 0) : QString("saturating")));
 }
 
 void MainWindow::onLoopTimeout()
@@ -320,13 +507,82 @@ void MainWindow::onLoopTimeout()
 
 void MainWindow::onCanReadable()
 {
-    struct can_frame frame;
-    ssize_t n = read(m_socket, &frame, sizeof(frame));
-    if (n <= 0) {
+    CanRxBatch batch;
+    int n = batch.read(m_socket, &m_rxStats, kRxBatch);
+    if (n < 0) {
         logText("SYS", QString("CAN read error: %1").arg(strerror(errno)));
         return;
     }
-    logFrame("RX", frame);
+    qint64 nowNs = realtimeNs();
+    qint64 ts = nowNs / 1000;
+    for (int i = 0; i < n; ++i) {
+        if (batch.kernelNs[i]) m_rxLatency.record(nowNs - batch.kernelNs[i]);
+        handleRxFrame(ts, batch.frames[i]);
+    }
+}
+
+void MainWindow::handleRxFrame(qint64 ts, const struct can_frame &frame)
+{
+    m_capture->push(ts, frame, false);
+    if (frame.can_id & CAN_ERR_FLAG) {
+        // counted by CanRxBatch; overruns come in bursts and are summarised in onStatsTimeout()
+        if (frame.can_id & CAN_ERR_BUSOFF) logText("ERR", "Bus-off");
+        if (frame.can_id & CAN_ERR_RESTARTED) logText("ERR", "Controller restarted");
+        return;
+    }
+    m_monitor->update(ts, frame);
+    if (ui->chkPlot->isChecked()) ui->plotSignals->append(ts, frame);
+    // in monitor view received frames are not appended row by row
+    if (!ui->chkMonitor->isChecked()) logFrame("RX", frame);
+}
+
+void MainWindow::onStatsTimeout()
+{
+    QStringList parts;
+    if (m_socket >= 0) {
+        CanRxCounters c = m_rxStats.snapshot();
+        quint64 dropped = c.dropped - m_rxLast.dropped;
+        quint64 overruns = (c.ctrlRxOverflow + c.ctrlTxOverflow) - (m_rxLast.ctrlRxOverflow + m_rxLast.ctrlTxOverflow);
+        parts << QString("RX %1 fr/s, dropped %2 (total %3), ctrl overruns %4, error-passive %5, bus-off %6, %7")
+                 .arg(c.frames - m_rxLast.frames).arg(dropped).arg(c.dropped)
+                 .arg(c.ctrlRxOverflow + c.ctrlTxOverflow).arg(c.errorPassive).arg(c.busOff)
+                 .arg(m_rxLatency.report("wake"));
+        if (dropped > 0)
+            logText("ERR", QString("%1 frames dropped by the socket queue in the last second (raise rcvbuf)").arg(dropped));
+        if (overruns > 0)
+            logText("ERR", QString("%1 controller overrun(s) in the last second").arg(overruns));
+        m_rxLast = c;
+    }
+    if (m_gateway->isRunning()) {
+        CanGateway::Stats st = m_gateway->stats();
+        parts << QString("GW out %1 fr/%2 dg, fill %3%, +%4/%5 us, in %6 fr, err %7, foreign %8 dg")
+                 .arg(st.framesToNet).arg(st.datagramsOut)
+                 .arg(st.fillRatio() * 100.0, 0, 'f', 1)
+                 .arg(st.avgLatencyUs(), 0, 'f', 0).arg(st.latencyMaxUs)
+                 .arg(st.framesFromNet).arg(st.decodeErrors + st.sendErrors + st.truncatedDatagrams)
+                 .arg(st.foreignDatagrams);
+    }
+    if (m_generator->isRunning()) {
+        LoadGenerator::Stats st = m_generator->stats();
+        QString gen = QString("GEN %1 fr/s (busy %2)").arg(st.sent - m_genLastSent).arg(st.txBusy);
+        if (st.received > 0) {
+            gen += QString(", rx %1 lost %2 (socket drops %3) reord %4, lat p50<=%5 p99<=%6 max %7 us")
+                   .arg(st.received).arg(st.lost).arg(st.rxDropped).arg(st.reordered)
+                   .arg(st.latP50Us).arg(st.latP99Us).arg(st.latMaxUs);
+        }
+        parts << gen;
+        m_genLastSent = st.sent;
+    }
+    if (m_can->isOpen()) {
+        // the gateway / low-latency socket has its own queue, so its own drops
+        CanRxCounters c = m_can->rxCounters();
+        QString can = QString("GW/LL socket dropped %1").arg(c.dropped);
+        if (m_can->isLowLatency()) can += ", " + m_can->latencyReport();
+        parts << can;
+    }
+    if (!m_indexStatus.isEmpty()) parts << m_indexStatus;
+    if (parts.isEmpty()) ui->statusbar->clearMessage();
+    else ui->statusbar->showMessage(parts.join("  |  "));
 }
 
 // ------------------------- logging helpers -------------------------
@@ -368,6 +624,116 @@ void MainWindow::updateCanIndicator(bool up)
     ui->lblStatusText->setText(up ? "Connected" : "Disconnected");
 }
 
+void MainWindow::configurePlot()
+{
+    QJsonArray specs = m_settingsJson.value("plot_signals").toArray();
+    int historyS = qMax(1, m_settingsJson.value("plot_history_s").toInt(3600));
+    int points = qMax(1024, m_settingsJson.value("plot_points").toInt(16384));
+    if (specs == m_plotSignals && historyS == m_plotHistoryS && points == m_plotPoints) return;
+    m_plotSignals = specs;
+    m_plotHistoryS = historyS;
+    m_plotPoints = points;
+
+    QVector<SignalDef> defs;
+    for (const QJsonValue &v : specs) {
+        SignalDef d;
+        if (SignalDef::parse(v.toString(), &d)) defs.append(d);
+        else logText("SYS", QString("Ignoring invalid plot signal: %1").arg(v.toString()));
+    }
+    ui->plotSignals->setSignals(defs, historyS, points);
+}
+
+void MainWindow::configureCapture()
+{
+    QString dir = m_settingsJson.value("capture_dir").toString();
+    if (dir.isEmpty()) {
+        dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        if (dir.isEmpty()) dir = ".";
+        dir += "/captures";
+    }
+
+    QVector<CaptureBuffer::Trigger> triggers;
+    const QJsonArray specs = m_settingsJson.value("capture_triggers").toArray();
+    for (const QJsonValue &v : specs) {
+        CaptureBuffer::Trigger t;
+        if (CaptureBuffer::parseTrigger(v.toString(), &t)) triggers.append(t);
+        else logText("SYS", QString("Ignoring invalid capture trigger: %1").arg(v.toString()));
+    }
+
+    bool wasArmed = m_capture->isArmed();
+    m_capture->disarm();
+    m_capture->configure(m_settingsJson.value("capture_pre_s").toInt(30),
+                         m_settingsJson.value("capture_post_s").toInt(10),
+                         m_settingsJson.value("bitrate").toInt(250000),
+                         dir, m_canInterface);
+    m_capture->setLimits(m_settingsJson.value("capture_holdoff_s").toInt(-1),
+                         m_settingsJson.value("capture_max_mb").toInt(1024));
+    m_capture->setTriggers(triggers);
+    if (wasArmed) m_capture->arm();
+}
+
+void MainWindow::updateCanManager(bool canUp)
+{
+    bool wantGateway = canUp && !m_gatewayEndpoint.isEmpty();
+    bool wantLowLat = canUp && m_lowLatency;
+
+    if (!wantGateway && m_gateway->isRunning()) {
+        m_gateway->stop();
+        logText("SYS", "Gateway stopped");
+    }
+    if (!wantLowLat && m_can->isLowLatency()) {
+        m_can->stopLowLatency();
+        logText("SYS", "Low-latency RX stopped");
+    }
+    if (!wantGateway && !wantLowLat) {
+        if (m_can->isOpen()) m_can->close();
+        return;
+    }
+
+    m_can->setSocketBuffers(m_rcvbuf, m_sndbuf);
+    if (!m_can->open(m_canInterface.toStdString())) {
+        logText("SYS", QString("Cannot open %1 for gateway / low-latency RX").arg(m_canInterface));
+        return;
+    }
+
+    // start() restarts an already running gateway with the new settings
+    if (wantGateway && m_gateway->start(m_gatewayEndpoint, m_gatewayFlushMs)) {
+        m_gateway->resetStats();
+        logText("SYS", QString("Gateway %1 <-> %2 (flush %3 ms)")
+                .arg(m_canInterface, m_gatewayEndpoint).arg(m_gatewayFlushMs));
+    }
+
+    if (wantLowLat) {
+        // the hook can only be swapped while the RX thread is stopped
+        m_can->stopLowLatency();
+        if (m_respondEnabled) {
+            uint32_t rxId = m_respondRxId;
+            struct can_frame resp;
+            std::memset(&resp, 0, sizeof(resp));
+            resp.can_id = (m_respondTxId & CAN_EFF_MASK) | CAN_EFF_FLAG;
+            resp.can_dlc = static_cast<__u8>(qMin(m_respondData.size(), 8));
+            std::memcpy(resp.data, m_respondData.constData(), resp.can_dlc);
+            m_can->setReactiveHook([rxId, resp](const struct can_frame &rx, struct can_frame *tx) {
+                if ((rx.can_id & CAN_EFF_MASK) != rxId) return false;
+                *tx = resp;
+                return true;
+            });
+        } else {
+            m_can->setReactiveHook(CanManager::ReactiveHook());
+        }
+
+        CanManager::LowLatencyOptions opt;
+        opt.cpu = m_lowLatCpu;
+        opt.busyPollUs = m_lowLatBusyPollUs;
+        opt.spinUs = m_lowLatSpinUs;
+        m_can->startLowLatency(opt);
+        logText("SYS", QString("Low-latency RX on %1 (cpu %2, busy poll %3 us, spin %4 us%5)")
+                .arg(m_canInterface).arg(m_lowLatCpu).arg(m_lowLatBusyPollUs).arg(m_lowLatSpinUs)
+                .arg(m_respondEnabled ? QString(", respond 0x%1 -> 0x%2").arg(m_respondRxId, 0, 16).arg(m_respondTxId, 0, 16)
+                                      : QString()));
+    }
+}
+
 // ------------------------- settings persistence -------------------------
 
 void MainWindow::applySettingsFromJson()
@@ -385,6 +751,30 @@ void MainWindow::applySettingsFromJson()
     if (m_settingsJson.contains("left")) m_leftData = QByteArray::fromHex(m_settingsJson.value("left").toString().toUtf8());
     if (m_settingsJson.contains("right")) m_rightData = QByteArray::fromHex(m_settingsJson.value("right").toString().toUtf8());
     if (m_settingsJson.contains("stop")) m_stopData = QByteArray::fromHex(m_settingsJson.value("stop").toString().toUtf8());
+    if (m_settingsJson.contains("gateway")) m_gatewayEndpoint = m_settingsJson.value("gateway").toString().trimmed();
+    if (m_settingsJson.contains("gateway_flush_ms")) m_gatewayFlushMs = qMax(0, m_settingsJson.value("gateway_flush_ms").toInt());
+    m_rcvbuf = qMax(0, m_settingsJson.value("rcvbuf").toInt(0));
+    m_sndbuf = qMax(0, m_settingsJson.value("sndbuf").toInt(0));
+    m_lowLatency = m_settingsJson.value("lowlat").toBool(false);
+    m_lowLatCpu = m_settingsJson.value("lowlat_cpu").toInt(-1);
+    m_lowLatBusyPollUs = m_settingsJson.value("lowlat_busy_poll_us").toInt(0);
+    m_lowLatSpinUs = m_settingsJson.value("lowlat_spin_us").toInt(500);
+    // "<rx id>:<tx id>#<data>", answered from the RX thread itself
+    m_respondEnabled = false;
+    QString respond = m_settingsJson.value("lowlat_respond").toString().trimmed();
+    if (!respond.isEmpty()) {
+        QRegExp re("^(?:0x)?([0-9a-fA-F]+):(?:0x)?([0-9a-fA-F]+)#([0-9a-fA-F]*)$");
+        if (re.exactMatch(respond)) {
+            m_respondRxId = re.cap(1).toUInt(nullptr, 16);
+            m_respondTxId = re.cap(2).toUInt(nullptr, 16);
+            m_respondData = QByteArray::fromHex(re.cap(3).toUtf8());
+            m_respondEnabled = true;
+        } else {
+            logText("SYS", QString("Ignoring invalid lowlat_respond: %1").arg(respond));
+        }
+    }
+    configureCapture();
+    configurePlot();
     // bitrate may be present but we don't need to apply here except showing as hint in interval placeholder
     if (m_settingsJson.contains("bitrate")) {
         ui->lineInterval->setPlaceholderText(QString::number(m_settingsJson.value("bitrate").toInt()));
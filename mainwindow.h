@@ -4,8 +4,14 @@
 #include <QTimer>
 #include <QSocketNotifier>
 #include <QJsonObject>
+#include <QJsonArray>
+#include "canmanager.h"
 
 namespace Ui { class MainWindow; }
+class CanGateway;
+class CaptureBuffer;
+class MonitorModel;
+class LoadGenerator;
 
 class MainWindow : public QMainWindow
 {
@@ -25,6 +31,12 @@ private slots:
     void onRightClicked();
     void onStopClicked();
     void onClearLogClicked();
+    void onCaptureToggled(bool on);
+    void onTriggerClicked();
+    void onOpenCaptureClicked();
+    void onMonitorToggled(bool on);
+    void onGenerateToggled(bool on);
+    void onPlotToggled(bool on);
 
     // loop
     void onLoopTimeout();
@@ -32,6 +44,9 @@ private slots:
     // socket read
     void onCanReadable();
 
+    // periodic statistics in the status bar
+    void onStatsTimeout();
+
 private:
     // helpers
     bool isCanInterfaceUp() const;
@@ -45,7 +60,11 @@ private:
 
     void logText(const QString &dir, const QString &text);
     void logFrame(const QString &dir, const struct can_frame &frame);
+    void handleRxFrame(qint64 ts, const struct can_frame &frame);
     void updateCanIndicator(bool up);
+    void updateCanManager(bool canUp);   // gateway + low-latency RX
+    void configureCapture();
+    void configurePlot();
 
     // settings
     void loadSettings();
@@ -58,6 +77,14 @@ private:
     // socketCAN
     int m_socket = -1;
     QSocketNotifier *m_notifier = nullptr;
+    int m_rcvbuf = 0;                // 0 = kernel default
+    int m_sndbuf = 0;
+
+    // RX accounting of m_socket, kept by CanRxBatch; m_rxLast is the previous status bar tick
+    CanRxStats m_rxStats;
+    CanRxCounters m_rxLast;
+    // kernel RX timestamp -> onCanReadable, the default path low-latency mode is compared with
+    RxLatencyHistogram m_rxLatency;
 
     // loop timer
     QTimer m_loopTimer;
@@ -65,6 +92,39 @@ private:
     bool m_loopMode = false;
     int m_loopIntervalMs = 1000;
 
+    // own CanManager socket on m_canInterface, used by the gateway and
+    // the low-latency RX mode
+    CanManager *m_can = nullptr;
+    CanGateway *m_gateway = nullptr;
+    QString m_gatewayEndpoint;
+    int m_gatewayFlushMs = 1;
+    bool m_lowLatency = false;
+    int m_lowLatCpu = -1;
+    int m_lowLatBusyPollUs = 0;
+    int m_lowLatSpinUs = 500;
+    bool m_respondEnabled = false;
+    uint32_t m_respondRxId = 0;
+    uint32_t m_respondTxId = 0;
+    QByteArray m_respondData;
+    QTimer m_statsTimer;
+
+    // pre/post-trigger capture fed from onCanReadable() / sendCanFrame()
+    CaptureBuffer *m_capture = nullptr;
+    QString m_indexStatus;           // capture browser index build, shown in the status bar
+
+    // one-row-per-ID monitor, repainted from m_monitorTimer instead of per frame
+    MonitorModel *m_monitor = nullptr;
+    QTimer m_monitorTimer;
+
+    // bus load generator (own TX thread and socket)
+    LoadGenerator *m_generator = nullptr;
+    quint64 m_genLastSent = 0;
+
+    // last applied plot settings; reapplying them would drop the plotted history
+    QJsonArray m_plotSignals;
+    int m_plotHistoryS = 0;
+    int m_plotPoints = 0;
+
     // config
     QJsonObject m_settingsJson;
     QString m_canInterface = QStringLiteral("can0");
@@ -0,0 +1,168 @@
+#include "monitormodel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <linux/can.h>
+#include <QColor>
+#include <QDateTime>
+
+// changed bytes stay highlighted this long
+static const qint64 kHighlightUs = 1000000;
+
+MonitorModel::MonitorModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+void MonitorModel::update(qint64 tsUs, const struct can_frame &frame)
+{
+    uint32_t id = frame.can_id & (CAN_EFF_FLAG | CAN_EFF_MASK);
+    Entry *e;
+    auto it = m_rowOf.constFind(id);
+    if (it != m_rowOf.constEnd()) {
+        e = &m_rows[it.value()];
+    } else {
+        e = &m_pending[id];
+        e->id = id;
+    }
+
+    // a remote request only carries the requested length; its data bytes are
+    // undefined, so it counts towards the row but leaves the payload alone
+    if (!(frame.can_id & CAN_RTR_FLAG)) {
+        int dlc = frame.can_dlc > 8 ? 8 : frame.can_dlc;
+        for (int i = 0; i < dlc; ++i) {
+            if (e->data[i] != frame.data[i] || i >= e->dlc) {
+                e->data[i] = frame.data[i];
+                e->changedUs[i] = tsUs;
+            }
+        }
+        e->dlc = uint8_t(dlc);
+    }
+    e->lastUs = tsUs;
+    e->count++;
+    e->dirty = true;
+}
+
+void MonitorModel::clear()
+{
+    beginResetModel();
+    m_rows.clear();
+    m_rowOf.clear();
+    m_pending.clear();
+    endResetModel();
+}
+
+int MonitorModel::fadeLevel(qint64 ageUs)
+{
+    if (ageUs < 1000000) return 0;
+    if (ageUs < 3000000) return 1;
+    if (ageUs < 10000000) return 2;
+    return 3;
+}
+
+uint8_t MonitorModel::highlightMask(const Entry &e) const
+{
+    uint8_t mask = 0;
+    for (int i = 0; i < e.dlc; ++i)
+        if (e.changedUs[i] != 0 && m_nowUs - e.changedUs[i] < kHighlightUs) mask |= uint8_t(1u << i);
+    return mask;
+}
+
+void MonitorModel::refresh()
+{
+    m_nowUs = QDateTime::currentMSecsSinceEpoch() * 1000;
+    double dt = m_lastRefreshUs ? (m_nowUs - m_lastRefreshUs) / 1e6 : 0.0;
+    m_lastRefreshUs = m_nowUs;
+
+    // new ids are rare; insert them at their sorted position
+    if (!m_pending.isEmpty()) {
+        QList<uint32_t> ids = m_pending.keys();
+        std::sort(ids.begin(), ids.end());
+        for (uint32_t id : ids) {
+            auto pos = std::lower_bound(m_rows.begin(), m_rows.end(), id,
+                                        [](const Entry &e, uint32_t v) { return e.id < v; });
+            int row = int(pos - m_rows.begin());
+            beginInsertRows(QModelIndex(), row, row);
+            m_rows.insert(row, m_pending.value(id));
+            endInsertRows();
+        }
+        m_pending.clear();
+        m_rowOf.clear();
+        for (int r = 0; r < m_rows.size(); ++r) m_rowOf.insert(m_rows[r].id, r);
+    }
+
+    for (int r = 0; r < m_rows.size(); ++r) {
+        Entry &e = m_rows[r];
+        if (dt > 0.0) {
+            double inst = double(e.count - e.countAtRefresh) / dt;
+            e.rate = e.rate == 0.0 ? inst : 0.7 * e.rate + 0.3 * inst;
+            if (e.rate < 0.05) e.rate = 0.0;
+        }
+        bool rateChanged = e.count != e.countAtRefresh || e.rate != 0.0;
+        e.countAtRefresh = e.count;
+
+        int fade = fadeLevel(m_nowUs - e.lastUs);
+        uint8_t hl = highlightMask(e);
+        if (!e.dirty && !rateChanged && fade == e.shownFade && hl == e.shownHighlight) continue;
+        e.dirty = false;
+        e.shownFade = fade;
+        e.shownHighlight = hl;
+        emit dataChanged(index(r, 0), index(r, ColumnCount - 1));
+    }
+}
+
+int MonitorModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return m_rows.size();
+}
+
+int MonitorModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return ColumnCount;
+}
+
+QVariant MonitorModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) return QVariant();
+    if (section == ColId) return QString("CAN ID");
+    if (section == ColDlc) return QString("DLC");
+    if (section == ColRate) return QString("Rate/s");
+    if (section == ColCount) return QString("Count");
+    if (section >= ColByte0 && section < ColByte0 + 8) return QString::number(section - ColByte0);
+    return QVariant();
+}
+
+QVariant MonitorModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) return QVariant();
+    const Entry &e = m_rows[index.row()];
+    int col = index.column();
+    int byte = col - ColByte0;
+    bool isByte = byte >= 0 && byte < 8;
+
+    if (role == Qt::DisplayRole) {
+        switch (col) {
+        case ColId:
+            if (e.id & CAN_EFF_FLAG) return QString::asprintf("0x%08X", e.id & CAN_EFF_MASK);
+            return QString::asprintf("0x%03X", e.id);
+        case ColDlc: return e.dlc;
+        case ColRate: return QString::number(e.rate, 'f', 1);
+        case ColCount: return e.count;
+        }
+        if (isByte && byte < e.dlc) return QString::asprintf("%02X", e.data[byte]);
+        return QVariant();
+    }
+    if (role == Qt::BackgroundRole && isByte && (e.shownHighlight & (1u << byte))) {
+        return QColor(255, 200, 120);
+    }
+    if (role == Qt::ForegroundRole) {
+        static const int alpha[] = { 255, 170, 110, 60 };
+        return QColor(0, 0, 0, alpha[qBound(0, e.shownFade, 3)]);
+    }
+    if (role == Qt::TextAlignmentRole && col != ColId) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    return QVariant();
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QVector>
+
+struct can_frame;
+
+// cansniffer-style view: one row per CAN ID, updated in place.
+//
+// update() is called per received frame and only touches that ID's entry
+// and marks it dirty; refresh() runs at display rate, inserts new IDs,
+// recomputes rates and emits dataChanged only for rows whose content,
+// changed-byte highlight or stale fade actually differs, so the UI cost
+// scales with the number of distinct IDs rather than the frame rate.
+class MonitorModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit MonitorModel(QObject *parent = nullptr);
+
+    void update(qint64 tsUs, const struct can_frame &frame);
+    void refresh();
+    void clear();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    enum { ColId, ColDlc, ColByte0, ColRate = ColByte0 + 8, ColCount, ColumnCount };
+
+    struct Entry {
+        uint32_t id = 0;       // raw can_id incl. EFF flag
+        uint8_t dlc = 0;
+        uint8_t data[8] = {0};
+        qint64 changedUs[8] = {0};
+        qint64 lastUs = 0;
+        quint64 count = 0;
+        quint64 countAtRefresh = 0;
+        double rate = 0.0;
+        bool dirty = false;
+        // what the view last saw, to skip repaints that would change nothing
+        int shownFade = -1;
+        uint8_t shownHighlight = 0;
+    };
+
+    static int fadeLevel(qint64 ageUs);
+    uint8_t highlightMask(const Entry &e) const;
+
+    QVector<Entry> m_rows;              // sorted by id
+    QHash<uint32_t, int> m_rowOf;
+    QHash<uint32_t, Entry> m_pending;   // ids seen since the last refresh
+    qint64 m_nowUs = 0;
+    qint64 m_lastRefreshUs = 0;
+};
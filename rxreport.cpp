@@ -0,0 +1,79 @@
+#include "rxreport.h"
+
+#include <cstdio>
+
+RxReport::RxReport(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setSingleShot(false);
+    connect(&m_timer, &QTimer::timeout, this, &RxReport::onTick);
+}
+
+bool RxReport::start(const QString &ifname, int intervalMs, int durationS, int rcvbuf, int sndbuf)
+{
+    m_ifname = ifname;
+    m_durationS = durationS;
+    m_can.setSocketBuffers(rcvbuf, sndbuf);
+    if (!m_can.open(ifname.toStdString())) {
+        std::fprintf(stderr, "cannot open %s\n", qPrintable(ifname));
+        return false;
+    }
+    m_haveIf = CanManager::readIfCounters(ifname.toStdString(), &m_ifFirst);
+    m_ifLast = m_ifFirst;
+
+    // the kernel caps unprivileged requests at rmem_max/wmem_max and doubles
+    // them for bookkeeping, so print what was granted next to what was asked
+    std::printf("# %s, interval %d ms, rcvbuf %d (requested %d), sndbuf %d (requested %d)\n",
+                qPrintable(ifname), intervalMs, m_can.effectiveRcvbuf(), rcvbuf,
+                m_can.effectiveSndbuf(), sndbuf);
+    std::printf("%8s %10s %10s %8s %8s %10s %10s %10s\n",
+                "t_s", "rx", "dropped", "drop%", "rx/s", "ctrl_ovr", "if_drop", "if_over");
+    std::fflush(stdout);
+    m_clock.start();
+    m_lastTickNs = 0;
+    m_timer.start(qMax(10, intervalMs));
+    return true;
+}
+
+void RxReport::onTick()
+{
+    CanRxCounters c = m_can.rxCounters();
+    quint64 rx = c.frames - m_last.frames;
+    quint64 dropped = c.dropped - m_last.dropped;
+    quint64 overruns = (c.ctrlRxOverflow + c.ctrlTxOverflow) - (m_last.ctrlRxOverflow + m_last.ctrlTxOverflow);
+    double total = double(rx + dropped);
+    double pct = total > 0 ? 100.0 * dropped / total : 0.0;
+    // timer ticks drift and stall under load; rate over the time that really passed
+    qint64 nowNs = m_clock.nsecsElapsed();
+    double secs = (nowNs - m_lastTickNs) / 1e9;
+    m_lastTickNs = nowNs;
+
+    CanIfCounters ifc;
+    quint64 ifDrop = 0, ifOver = 0;
+    if (m_haveIf && CanManager::readIfCounters(m_ifname.toStdString(), &ifc)) {
+        ifDrop = ifc.rxDropped - m_ifLast.rxDropped;
+        ifOver = ifc.rxOverErrors - m_ifLast.rxOverErrors;
+        m_ifLast = ifc;
+    }
+
+    std::printf("%8.1f %10llu %10llu %8.3f %8.0f %10llu %10llu %10llu\n",
+                m_clock.elapsed() / 1000.0, (unsigned long long)rx, (unsigned long long)dropped,
+                pct, secs > 0.0 ? rx / secs : 0.0, (unsigned long long)overruns,
+                (unsigned long long)ifDrop, (unsigned long long)ifOver);
+    std::fflush(stdout);
+    m_last = c;
+
+    if (m_durationS > 0 && m_clock.elapsed() >= qint64(m_durationS) * 1000) {
+        m_timer.stop();
+        double all = double(c.frames + c.dropped);
+        std::printf("# total rx %llu, dropped %llu (%.3f%%), ctrl overruns %llu, bus-off %llu, if rx_dropped %llu, rx_over_errors %llu\n",
+                    (unsigned long long)c.frames, (unsigned long long)c.dropped,
+                    all > 0 ? 100.0 * c.dropped / all : 0.0,
+                    (unsigned long long)(c.ctrlRxOverflow + c.ctrlTxOverflow),
+                    (unsigned long long)c.busOff,
+                    (unsigned long long)(m_ifLast.rxDropped - m_ifFirst.rxDropped),
+                    (unsigned long long)(m_ifLast.rxOverErrors - m_ifFirst.rxOverErrors));
+        std::fflush(stdout);
+        emit finished();
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "canmanager.h"
+
+// Headless receive report (qt_canctl_2.2 --report): opens a CanManager on
+// the interface and prints frames received vs. dropped per interval, so
+// socket buffer sizes can be tuned against real bus load.
+class RxReport : public QObject
+{
+    Q_OBJECT
+public:
+    explicit RxReport(QObject *parent = nullptr);
+
+    bool start(const QString &ifname, int intervalMs, int durationS, int rcvbuf, int sndbuf);
+
+signals:
+    void finished();
+
+private slots:
+    void onTick();
+
+private:
+    CanManager m_can;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    qint64 m_lastTickNs = 0;
+    QString m_ifname;
+    int m_durationS = 0;
+    CanRxCounters m_last;
+    CanIfCounters m_ifFirst;
+    CanIfCounters m_ifLast;
+    bool m_haveIf = false;
+};
@@ -22,6 +22,8 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     ui->editLeft->setText("");
     ui->editRight->setText("");
     ui->editStop->setText("");
+    ui->editGateway->setText("");
+    ui->editGatewayFlush->setText("1");
 
     // connect OK / Cancel
     connect(ui->buttonBoxOk, &QPushButton::clicked, this, &SettingsDialog::onOkClicked);
@@ -101,9 +103,19 @@ QByteArray SettingsDialog::backwardData() const { return parseHexString(ui->edit
 QByteArray SettingsDialog::leftData() const { return parseHexString(ui->editLeft->text()); }
 QByteArray SettingsDialog::rightData() const { return parseHexString(ui->editRight->text()); }
 QByteArray SettingsDialog::stopData() const { return parseHexString(ui->editStop->text()); }
+QString SettingsDialog::gatewayEndpoint() const { return ui->editGateway->text().trimmed(); }
+
+int SettingsDialog::gatewayFlushMs() const
+{
+    bool ok=false;
+    int ms = ui->editGatewayFlush->text().trimmed().toInt(&ok);
+    if (!ok || ms < 0) return 1;
+    return ms;
+}
 
 void SettingsDialog::loadFromJson(const QJsonObject &obj)
 {
+    m_loaded = obj;
     if (obj.contains("can_id")) ui->editCanID->setText(obj["can_id"].toString());
     if (obj.contains("bitrate")) ui->editBitrate->setText(QString::number(obj["bitrate"].toInt()));
     if (obj.contains("forward")) ui->editForward->setText(obj["forward"].toString());
@@ -111,11 +123,13 @@ void SettingsDialog::loadFromJson(const QJsonObject &obj)
     if (obj.contains("left")) ui->editLeft->setText(obj["left"].toString());
     if (obj.contains("right")) ui->editRight->setText(obj["right"].toString());
     if (obj.contains("stop")) ui->editStop->setText(obj["stop"].toString());
+    if (obj.contains("gateway")) ui->editGateway->setText(obj["gateway"].toString());
+    if (obj.contains("gateway_flush_ms")) ui->editGatewayFlush->setText(QString::number(obj["gateway_flush_ms"].toInt()));
 }
 
 QJsonObject SettingsDialog::toJson() const
 {
-    QJsonObject obj;
+    QJsonObject obj = m_loaded;
     obj["can_id"]   = ui->editCanID->text();
     obj["bitrate"]  = ui->editBitrate->text().toInt();
     obj["forward"]  = ui->editForward->text();
@@ -123,5 +137,7 @@ QJsonObject SettingsDialog::toJson() const
     obj["left"]     = ui->editLeft->text();
     obj["right"]    = ui->editRight->text();
     obj["stop"]     = ui->editStop->text();
+    obj["gateway"]  = gatewayEndpoint();
+    obj["gateway_flush_ms"] = gatewayFlushMs();
     return obj;
 }
@@ -19,6 +19,8 @@ public:
     QByteArray leftData() const;
     QByteArray rightData() const;
     QByteArray stopData() const;
+    QString gatewayEndpoint() const;
+    int gatewayFlushMs() const;
 
     void loadFromJson(const QJsonObject &obj);
     QJsonObject toJson() const;
@@ -28,5 +30,6 @@ private slots:
 
 private:
     Ui::SettingsDialog *ui;
+    QJsonObject m_loaded;   // keeps keys that have no field in this dialog
     QByteArray parseHexString(const QString &s) const;
 };
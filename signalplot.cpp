@@ -0,0 +1,235 @@
+#include "signalplot.h"
+
+#include <cmath>
+#include <linux/can.h>
+#include <QDateTime>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPolygonF>
+#include <QWheelEvent>
+
+static const qint64 kMinSpanUs = 1000;   // 1 ms across the whole width
+
+static const QColor kTraceColors[] = {
+    QColor(31, 119, 180), QColor(214, 39, 40), QColor(44, 160, 44), QColor(255, 127, 14),
+    QColor(148, 103, 189), QColor(140, 86, 75), QColor(227, 119, 194), QColor(23, 190, 207),
+};
+
+static QString spanText(qint64 us)
+{
+    if (us >= 3600LL * 1000000) return QString("%1 h").arg(us / 3.6e9, 0, 'g', 3);
+    if (us >= 60LL * 1000000) return QString("%1 min").arg(us / 6e7, 0, 'g', 3);
+    if (us >= 1000000) return QString("%1 s").arg(us / 1e6, 0, 'g', 3);
+    return QString("%1 ms").arg(us / 1e3, 0, 'g', 3);
+}
+
+SignalPlot::SignalPlot(QWidget *parent)
+    : QWidget(parent)
+{
+    setMouseTracking(false);
+    setAutoFillBackground(false);
+    m_repaintTimer.setSingleShot(false);
+    connect(&m_repaintTimer, &QTimer::timeout, this, &SignalPlot::onRepaintTimeout);
+}
+
+void SignalPlot::setSignals(const QVector<SignalDef> &defs, int historySeconds, int pointsPerLevel)
+{
+    m_historyUs = qint64(qMax(1, historySeconds)) * 1000000;
+    m_traces.clear();
+    m_byKey.clear();
+    for (const SignalDef &d : defs) {
+        m_byKey[d.key].append(m_traces.size());
+        int ncolors = int(sizeof(kTraceColors) / sizeof(kTraceColors[0]));
+        m_traces.append(Trace{ d, SignalSeries(m_historyUs, pointsPerLevel),
+                               kTraceColors[m_traces.size() % ncolors] });
+    }
+    m_spanUs = qMin(m_spanUs, m_historyUs);
+    m_follow = true;
+    update();
+}
+
+void SignalPlot::append(qint64 tsUs, const struct can_frame &frame)
+{
+    if (frame.can_id & CAN_RTR_FLAG) return;
+    auto it = m_byKey.constFind(frame.can_id & (CAN_EFF_FLAG | CAN_EFF_MASK));
+    if (it == m_byKey.constEnd()) return;
+    for (int i : it.value()) {
+        Trace &t = m_traces[i];
+        double v;
+        if (t.def.decode(frame, &v)) t.series.append(tsUs, float(v));
+    }
+    m_dirty = true;
+}
+
+void SignalPlot::clear()
+{
+    for (Trace &t : m_traces) t.series.clear();
+    m_follow = true;
+    update();
+}
+
+void SignalPlot::setRecording(bool on)
+{
+    m_recording = on;
+    if (on) m_repaintTimer.start(50);
+    else m_repaintTimer.stop();
+    update();
+}
+
+void SignalPlot::onRepaintTimeout()
+{
+    // following scrolls with wall time even when nothing arrives
+    if (!isVisible() || (!m_dirty && !m_follow)) return;
+    m_dirty = false;
+    update();
+}
+
+QRect SignalPlot::plotRect() const
+{
+    return rect().adjusted(60, 18, -8, -18);
+}
+
+qint64 SignalPlot::newestUs() const
+{
+    qint64 newest = 0;
+    for (const Trace &t : m_traces)
+        if (!t.series.isEmpty()) newest = qMax(newest, t.series.lastUs());
+    return newest;
+}
+
+qint64 SignalPlot::viewEndUs() const
+{
+    if (!m_follow) return m_endUs;
+    if (m_recording) return QDateTime::currentMSecsSinceEpoch() * 1000;
+    qint64 newest = newestUs();
+    return newest ? newest : QDateTime::currentMSecsSinceEpoch() * 1000;
+}
+
+void SignalPlot::paintEvent(QPaintEvent *)
+{
+    QPainter p(this);
+    p.fillRect(rect(), Qt::white);
+    QRect r = plotRect();
+    p.setPen(QColor(180, 180, 180));
+    p.drawRect(r.adjusted(0, 0, -1, -1));
+
+    if (m_traces.isEmpty()) {
+        p.setPen(Qt::gray);
+        p.drawText(r, Qt::AlignCenter, "No signals configured (plot_signals in settings.json)");
+        return;
+    }
+
+    qint64 t1 = viewEndUs();
+    qint64 t0 = t1 - m_spanUs;
+    int width = qMax(1, r.width() - 2);
+
+    // one query per trace; the shared y range comes from what is in view
+    QVector<QVector<SignalSeries::Column>> cols(m_traces.size());
+    float lo = 0.0f, hi = 0.0f;
+    bool any = false;
+    for (int i = 0; i < m_traces.size(); ++i) {
+        if (!m_traces[i].series.query(t0, t1, width, &cols[i])) continue;
+        for (const SignalSeries::Column &c : cols[i]) {
+            if (!c.valid) continue;
+            if (!any) { lo = c.min; hi = c.max; any = true; }
+            lo = qMin(lo, c.min);
+            hi = qMax(hi, c.max);
+        }
+    }
+    if (hi - lo < 1e-6f) { lo -= 0.5f; hi += 0.5f; }
+    float pad = (hi - lo) * 0.05f;
+    lo -= pad;
+    hi += pad;
+    double yScale = double(r.height() - 2) / double(hi - lo);
+    auto yOf = [&](float v) { return r.bottom() - 1 - (v - lo) * yScale; };
+
+    p.setRenderHint(QPainter::Antialiasing, false);
+    QPolygonF line;
+    for (int i = 0; i < m_traces.size(); ++i) {
+        // min/max envelope per pixel column, joined column to column
+        line.clear();
+        for (int x = 0; x < cols[i].size(); ++x) {
+            const SignalSeries::Column &c = cols[i][x];
+            if (!c.valid) continue;
+            double px = r.left() + 1 + x;
+            line << QPointF(px, yOf(c.max)) << QPointF(px, yOf(c.min));
+        }
+        if (line.isEmpty()) continue;
+        p.setPen(m_traces[i].color);
+        p.drawPolyline(line);
+    }
+
+    // axes and legend
+    p.setPen(Qt::black);
+    QFontMetrics fm = p.fontMetrics();
+    p.drawText(QRect(0, r.top() - 2, r.left() - 4, fm.height()), Qt::AlignRight, QString::number(hi, 'g', 5));
+    p.drawText(QRect(0, r.bottom() - fm.height() + 2, r.left() - 4, fm.height()), Qt::AlignRight,
+               QString::number(lo, 'g', 5));
+    QString fmt = m_spanUs < 10LL * 1000000 ? "hh:mm:ss.zzz" : "hh:mm:ss";
+    p.drawText(QRect(r.left(), r.bottom() + 2, r.width(), fm.height()), Qt::AlignLeft,
+               QDateTime::fromMSecsSinceEpoch(t0 / 1000).toString(fmt));
+    p.drawText(QRect(r.left(), r.bottom() + 2, r.width(), fm.height()), Qt::AlignRight,
+               QDateTime::fromMSecsSinceEpoch(t1 / 1000).toString(fmt));
+    p.drawText(QRect(r.left(), r.bottom() + 2, r.width(), fm.height()), Qt::AlignHCenter,
+               spanText(m_spanUs) + (m_follow ? "" : "  (paused, double-click to follow)"));
+
+    int x = r.left();
+    for (const Trace &t : m_traces) {
+        p.setPen(t.color);
+        p.drawText(x, fm.ascent() + 1, t.def.name);
+        x += fm.horizontalAdvance(t.def.name) + 12;
+    }
+}
+
+void SignalPlot::wheelEvent(QWheelEvent *event)
+{
+    QRect r = plotRect();
+    int steps = event->angleDelta().y() / 120;
+    if (steps == 0 || r.width() <= 0) return;
+
+    qint64 end = viewEndUs();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    double cursorX = event->position().x();
+#else
+    double cursorX = event->x();
+#endif
+    double frac = qBound(0.0, (cursorX - r.left()) / r.width(), 1.0);
+    qint64 cursorUs = end - m_spanUs + qint64(frac * m_spanUs);
+
+    double factor = std::pow(1.25, -steps);
+    qint64 span = qBound(kMinSpanUs, qint64(m_spanUs * factor), m_historyUs);
+    if (!m_follow) m_endUs = cursorUs + qint64((1.0 - frac) * span);
+    m_spanUs = span;
+    event->accept();
+    update();
+}
+
+void SignalPlot::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton) return;
+    m_dragging = true;
+    m_dragX = event->x();
+    m_dragEndUs = viewEndUs();
+}
+
+void SignalPlot::mouseMoveEvent(QMouseEvent *event)
+{
+    QRect r = plotRect();
+    if (!m_dragging || r.width() <= 0) return;
+    qint64 end = m_dragEndUs - qint64(double(event->x() - m_dragX) / r.width() * m_spanUs);
+    qint64 newest = m_recording ? QDateTime::currentMSecsSinceEpoch() * 1000 : newestUs();
+    m_follow = end >= newest;
+    m_endUs = qMin(end, newest);
+    update();
+}
+
+void SignalPlot::mouseReleaseEvent(QMouseEvent *)
+{
+    m_dragging = false;
+}
+
+void SignalPlot::mouseDoubleClickEvent(QMouseEvent *)
+{
+    m_follow = true;
+    update();
+}
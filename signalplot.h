@@ -0,0 +1,68 @@
+#pragma once
+#include <QWidget>
+#include <QColor>
+#include <QHash>
+#include <QTimer>
+#include <QVector>
+#include "signalseries.h"
+
+struct can_frame;
+
+// Live plot of decoded CAN signals over time.
+//
+// Each signal is stored in a SignalSeries min/max pyramid, so append() from
+// the RX path is O(1) per frame and a repaint costs O(width) per signal no
+// matter how many hours are in view. Wheel zooms around the cursor, drag
+// pans, double-click returns to following the newest data.
+class SignalPlot : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit SignalPlot(QWidget *parent = nullptr);
+
+    // replaces all signals and drops their data
+    void setSignals(const QVector<SignalDef> &defs, int historySeconds, int pointsPerLevel);
+    int signalCount() const { return m_traces.size(); }
+
+    void append(qint64 tsUs, const struct can_frame &frame);
+    void clear();
+
+    // while recording the view keeps repainting at display rate
+    void setRecording(bool on);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+private:
+    struct Trace {
+        SignalDef def;
+        SignalSeries series;
+        QColor color;
+    };
+
+    QRect plotRect() const;
+    qint64 viewEndUs() const;
+    qint64 newestUs() const;
+    void onRepaintTimeout();
+
+    QVector<Trace> m_traces;
+    QHash<uint32_t, QVector<int>> m_byKey;   // CAN id -> trace indexes
+    qint64 m_historyUs = 3600LL * 1000000;
+
+    qint64 m_spanUs = 10LL * 1000000;        // visible time range
+    qint64 m_endUs = 0;                      // right edge when not following
+    bool m_follow = true;
+    bool m_dirty = false;
+    bool m_recording = false;
+
+    bool m_dragging = false;
+    int m_dragX = 0;
+    qint64 m_dragEndUs = 0;
+
+    QTimer m_repaintTimer;
+};
@@ -0,0 +1,192 @@
+#include "signalseries.h"
+
+#include <linux/can.h>
+#include <QStringList>
+
+bool SignalDef::parse(const QString &spec, SignalDef *out)
+{
+    QStringList parts = spec.trimmed().split(':');
+    if (parts.size() < 3 || parts.size() > 5 || parts[0].isEmpty()) return false;
+
+    SignalDef d;
+    d.name = parts[0];
+
+    bool ok = false;
+    QString id = parts[1];
+    d.key = id.toUInt(&ok, 16);
+    if (!ok || d.key > CAN_EFF_MASK) return false;
+    if (id.size() > 3 || d.key > CAN_SFF_MASK) d.key |= CAN_EFF_FLAG;
+
+    // <start>|<len>@<order><sign>
+    QString layout = parts[2];
+    int bar = layout.indexOf('|');
+    int at = layout.indexOf('@');
+    if (bar < 0 || at < bar || layout.size() != at + 3) return false;
+    d.startBit = layout.left(bar).toInt(&ok);
+    if (!ok || d.startBit < 0 || d.startBit > 63) return false;
+    d.length = layout.mid(bar + 1, at - bar - 1).toInt(&ok);
+    if (!ok || d.length < 1 || d.length > 64) return false;
+    QChar order = layout[at + 1];
+    QChar sign = layout[at + 2];
+    if ((order != '0' && order != '1') || (sign != '+' && sign != '-')) return false;
+    d.littleEndian = order == '1';
+    d.isSigned = sign == '-';
+
+    if (parts.size() > 3) {
+        d.scale = parts[3].toDouble(&ok);
+        if (!ok) return false;
+    }
+    if (parts.size() > 4) {
+        d.offset = parts[4].toDouble(&ok);
+        if (!ok) return false;
+    }
+    *out = d;
+    return true;
+}
+
+bool SignalDef::decode(const struct can_frame &frame, double *value) const
+{
+    int bits = (frame.can_dlc > 8 ? 8 : frame.can_dlc) * 8;
+    uint64_t raw = 0;
+
+    if (littleEndian) {
+        if (startBit + length > bits) return false;
+        for (int i = 0; i < length; ++i) {
+            int b = startBit + i;
+            raw |= uint64_t((frame.data[b / 8] >> (b % 8)) & 1) << i;
+        }
+    } else {
+        // Motorola: start bit is the MSB, walking down within a byte and
+        // on to bit 7 of the next byte
+        int b = startBit;
+        for (int i = 0; i < length; ++i) {
+            if (b < 0 || b >= bits) return false;
+            raw = (raw << 1) | ((frame.data[b / 8] >> (b % 8)) & 1);
+            b = (b % 8 == 0) ? b + 15 : b - 1;
+        }
+    }
+
+    double v;
+    if (isSigned && length < 64 && (raw & (uint64_t(1) << (length - 1))))
+        v = double(int64_t(raw | (~uint64_t(0) << length)));
+    else if (isSigned)
+        v = double(int64_t(raw));
+    else
+        v = double(raw);
+    *value = v * scale + offset;
+    return true;
+}
+
+SignalSeries::SignalSeries(qint64 historyUs, int nodesPerLevel, int levels)
+    : m_historyUs(historyUs)
+{
+    m_levels.resize(qMax(1, levels));
+    quint64 span = 1;
+    for (Level &l : m_levels) {
+        l.ring.resize(qMax(16, nodesPerLevel));
+        l.span = span;
+        span *= kFanout;
+    }
+}
+
+void SignalSeries::clear()
+{
+    for (Level &l : m_levels) {
+        l.closed = 0;
+        l.openSamples = 0;
+    }
+    m_lastUs = 0;
+}
+
+void SignalSeries::append(qint64 tUs, float value)
+{
+    // keep time monotonic across clock steps, the searches rely on it
+    if (tUs < m_lastUs) tUs = m_lastUs;
+    m_lastUs = tUs;
+
+    for (Level &l : m_levels) {
+        if (l.openSamples == 0) {
+            l.open = { tUs, tUs, value, value };
+        } else {
+            l.open.t1 = tUs;
+            if (value < l.open.min) l.open.min = value;
+            if (value > l.open.max) l.open.max = value;
+        }
+        if (++l.openSamples == l.span) {
+            l.ring[int(l.closed % quint64(l.ring.size()))] = l.open;
+            l.closed++;
+            l.openSamples = 0;
+        }
+    }
+}
+
+quint64 SignalSeries::oldest(const Level &l) const
+{
+    quint64 cap = quint64(l.ring.size());
+    return l.closed > cap ? l.closed - cap : 0;
+}
+
+quint64 SignalSeries::lowerBound(const Level &l, qint64 tUs) const
+{
+    quint64 lo = oldest(l), hi = l.closed;
+    while (lo < hi) {
+        quint64 mid = lo + (hi - lo) / 2;
+        if (at(l, mid).t1 < tUs) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+qint64 SignalSeries::firstUs() const
+{
+    qint64 first = m_lastUs;
+    for (const Level &l : m_levels) {
+        if (l.closed > 0) first = qMin(first, at(l, oldest(l)).t0);
+        else if (l.openSamples > 0) first = qMin(first, l.open.t0);
+    }
+    return qMax(first, m_lastUs - m_historyUs);
+}
+
+bool SignalSeries::query(qint64 t0Us, qint64 t1Us, int columns, QVector<Column> *out) const
+{
+    out->fill(Column{0.0f, 0.0f, false}, qMax(columns, 0));
+    t0Us = qMax(t0Us, m_lastUs - m_historyUs);
+    if (isEmpty() || columns <= 0 || t1Us <= t0Us) return false;
+
+    // finest level that still reaches back to t0 without handing us more
+    // than a few nodes per column
+    int lv = 0;
+    for (; lv < m_levels.size() - 1; ++lv) {
+        const Level &l = m_levels[lv];
+        bool covers = oldest(l) == 0 || at(l, oldest(l)).t0 <= t0Us;
+        quint64 n = lowerBound(l, t1Us) - lowerBound(l, t0Us);
+        if (covers && n <= quint64(columns) * kFanout) break;
+    }
+    const Level &l = m_levels[lv];
+
+    double colPerUs = double(columns) / double(t1Us - t0Us);
+    bool any = false;
+    auto merge = [&](const Node &n) {
+        int c0 = int(qMax(0.0, (n.t0 - t0Us) * colPerUs));
+        int c1 = int(qMin(double(columns - 1), (n.t1 - t0Us) * colPerUs));
+        for (int c = c0; c <= c1; ++c) {
+            Column &col = (*out)[c];
+            if (!col.valid) {
+                col = Column{n.min, n.max, true};
+            } else {
+                if (n.min < col.min) col.min = n.min;
+                if (n.max > col.max) col.max = n.max;
+            }
+        }
+        any = true;
+    };
+
+    for (quint64 i = lowerBound(l, t0Us); i < l.closed; ++i) {
+        const Node &n = at(l, i);
+        if (n.t0 >= t1Us) break;
+        merge(n);
+    }
+    // samples not yet folded into a closed node at this level
+    if (l.openSamples > 0 && l.open.t0 < t1Us && l.open.t1 >= t0Us) merge(l.open);
+    return any;
+}
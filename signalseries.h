@@ -0,0 +1,81 @@
+#pragma once
+#include <QString>
+#include <QVector>
+
+struct can_frame;
+
+// A signal carried in a CAN frame, DBC style: start bit, length, byte
+// order (Intel = little endian), signedness, value = raw * scale + offset.
+struct SignalDef
+{
+    QString name;
+    uint32_t key = 0;          // CAN id, with CAN_EFF_FLAG for 29-bit ids
+    int startBit = 0;
+    int length = 8;
+    bool littleEndian = true;
+    bool isSigned = false;
+    double scale = 1.0;
+    double offset = 0.0;
+
+    // "<name>:<id>:<start>|<len>@<1|0><+|->[:<scale>[:<offset>]]" with the
+    // DBC meaning of start bit and @1 (Intel) / @0 (Motorola),
+    // e.g. "rpm:18FEF100:24|16@1+:0.125" or a plain byte "b2:123:16|8@1+"
+    static bool parse(const QString &spec, SignalDef *out);
+    bool decode(const struct can_frame &frame, double *value) const;
+};
+
+// Multi-resolution min/max pyramid over a time series.
+//
+// Level k aggregates kFanout^k consecutive samples into one node
+// (time span + min/max). Every level is a ring of the same capacity, so
+// memory is fixed while coarser levels reach further back in time.
+// append() updates the open node of each level: O(levels) = O(1).
+// query() picks the finest level that covers the requested range with at
+// most a few nodes per output column, so drawing costs O(columns).
+class SignalSeries
+{
+public:
+    struct Column {
+        float min;
+        float max;
+        bool valid;
+    };
+
+    // data older than historyUs before the newest sample is never returned
+    explicit SignalSeries(qint64 historyUs = 3600LL * 1000000, int nodesPerLevel = 16384, int levels = 8);
+
+    void append(qint64 tUs, float value);
+    void clear();
+
+    bool isEmpty() const { return m_levels[0].closed == 0; }
+    qint64 firstUs() const;   // oldest time still inside the history
+    qint64 lastUs() const { return m_lastUs; }
+
+    // min/max per column for [t0, t1); returns false if nothing in range
+    bool query(qint64 t0Us, qint64 t1Us, int columns, QVector<Column> *out) const;
+
+private:
+    enum { kFanout = 8 };
+
+    struct Node {
+        qint64 t0;
+        qint64 t1;
+        float min;
+        float max;
+    };
+    struct Level {
+        QVector<Node> ring;
+        quint64 closed = 0;        // nodes completed so far
+        quint64 span = 1;          // samples per node
+        Node open = {0, 0, 0.0f, 0.0f};
+        quint64 openSamples = 0;
+    };
+
+    quint64 oldest(const Level &l) const;
+    quint64 lowerBound(const Level &l, qint64 tUs) const;   // first node with t1 >= tUs
+    const Node &at(const Level &l, quint64 i) const { return l.ring[int(i % quint64(l.ring.size()))]; }
+
+    QVector<Level> m_levels;
+    qint64 m_historyUs;
+    qint64 m_lastUs = 0;
+};